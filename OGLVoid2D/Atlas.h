@@ -0,0 +1,214 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "utilDefs.h"
+#include "GLState.h"
+
+namespace voi {
+	/*skyline bottom left packer, the free space is kept as the top edge of what was placed, each rect goes
+	where its top ends lowest (leftmost on ties)*/
+	class SkylinePacker {
+		struct Segment {
+			ui32 x, y, width;
+		};
+
+		ui32 width, height;
+		std::vector<Segment> skyline;
+
+	public:
+		SkylinePacker(ui32 _width, ui32 _height) : width(_width), height(_height) {
+			skyline.push_back({ 0, 0, _width });
+		}
+
+		bool insert(ui32 w, ui32 h, ui32& outX, ui32& outY) {
+			size_t bestIndex = skyline.size();
+			ui32 bestTop = 0xffffffff;
+
+			for (size_t i = 0; i < skyline.size(); i++) {
+				const i64 y = fit(i, w, h);
+				if (y >= 0 && y + h < bestTop) {
+					bestTop = (ui32)y + h;
+					bestIndex = i;
+				}
+			}
+			if (bestIndex == skyline.size()) return false;
+
+			outX = skyline[bestIndex].x;
+			outY = bestTop - h;
+			place(bestIndex, outX, bestTop, w);
+			return true;
+		}
+
+	private:
+		/*height a rect with its left edge on segment "i" rests at, -1 when it doesn't fit*/
+		i64 fit(size_t i, ui32 w, ui32 h) {
+			if (skyline[i].x + w > width) return -1;
+
+			ui32 y = 0;
+			i64 remaining = w;
+			for (size_t j = i; remaining > 0; j++) {
+				if (skyline[j].y > y) y = skyline[j].y;
+				if (y + h > height) return -1;
+				remaining -= skyline[j].width;
+			}
+			return y;
+		}
+
+		void place(size_t index, ui32 x, ui32 top, ui32 w) {
+			skyline.insert(skyline.begin() + index, { x, top, w });
+
+			/*the segments under the new one are cut or dropped*/
+			const ui32 end = x + w;
+			for (size_t i = index + 1; i < skyline.size();) {
+				if (skyline[i].x >= end) break;
+
+				const ui32 covered = end - skyline[i].x;
+				if (skyline[i].width <= covered) {
+					skyline.erase(skyline.begin() + i);
+					continue;
+				}
+				skyline[i].x += covered;
+				skyline[i].width -= covered;
+				break;
+			}
+
+			for (size_t i = 0; i + 1 < skyline.size();) {
+				if (skyline[i].y == skyline[i + 1].y) {
+					skyline[i].width += skyline[i + 1].width;
+					skyline.erase(skyline.begin() + i + 1);
+				}
+				else {
+					i++;
+				}
+			}
+		}
+	};
+
+	/*small images packed into PAGE_SIZE pages, each page is one engine texture so sprites of different images
+	still batch together, every region is surrounded by PADDING copies of its edge pixels so filtering and
+	the first mip level don't pick up the neighbours*/
+	class TextureAtlas {
+	public:
+		static const ui32 PAGE_SIZE = 1024;
+		static const ui32 PADDING = 2;
+		/*bigger images get a texture of their own*/
+		static const ui32 MAX_REGION_SIZE = 256;
+
+		struct Region {
+			ui32 page;
+			ui32 x, y, width, height;
+			// uv offset (x, y) and scale (z, w) that map the image's [0,1] coordinates into the page
+			float uvRect[4];
+			// some pixel isn't fully opaque
+			bool alpha;
+		};
+
+		/*true when any pixel of an image of "channels" bytes per pixel has alpha under 255*/
+		static bool hasAlpha(ui32 width, ui32 height, const ui8* data, ui32 channels) {
+			if (channels != 4) return false;
+			for (size_t p = 0; p < (size_t)width * height; p++) {
+				if (data[p * 4 + 3] < 255) return true;
+			}
+			return false;
+		}
+
+	private:
+		struct Page {
+			ui32 texture;
+			ui32 name;
+			SkylinePacker packer;
+		};
+
+		std::vector<Page> pages;
+		std::vector<Region> regions;
+		std::vector<ui8> padded;
+
+	public:
+		static bool fits(ui32 width, ui32 height) { return width <= MAX_REGION_SIZE && height <= MAX_REGION_SIZE; }
+
+		/*makes gl texture "name" a new page, "texture" is the engine's index for it*/
+		void addPage(ui32 texture, ui32 name) {
+			GLState::bindTexture(0, name);
+
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			/*regions start on even texels, so level 1 still keeps a texel of padding between them*/
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1);
+
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, PAGE_SIZE, PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			glTexImage2D(GL_TEXTURE_2D, 1, GL_RGBA, PAGE_SIZE / 2, PAGE_SIZE / 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+			pages.push_back({ texture, name, SkylinePacker(PAGE_SIZE, PAGE_SIZE) });
+		}
+
+		/*packs an image of "channels" (3 or 4) bytes per pixel, returns its region or -1 when no page has room*/
+		i32 add(ui32 width, ui32 height, const ui8* data, ui32 channels) {
+			if (!fits(width, height)) return -1;
+
+			/*rounded to even so every region keeps even coordinates*/
+			const ui32 paddedW = (width + 2 * PADDING + 1) & ~1u;
+			const ui32 paddedH = (height + 2 * PADDING + 1) & ~1u;
+
+			for (ui32 p = 0; p < pages.size(); p++) {
+				ui32 x, y;
+				if (!pages[p].packer.insert(paddedW, paddedH, x, y)) continue;
+
+				Region region = { p, x + PADDING, y + PADDING, width, height, {}, hasAlpha(width, height, data, channels) };
+				region.uvRect[0] = (float)region.x / PAGE_SIZE;
+				region.uvRect[1] = (float)region.y / PAGE_SIZE;
+				region.uvRect[2] = (float)width / PAGE_SIZE;
+				region.uvRect[3] = (float)height / PAGE_SIZE;
+
+				regions.push_back(region);
+				upload(regions.back(), data, channels);
+				return regions.size() - 1;
+			}
+			return -1;
+		}
+
+		/*rewrites a region with an image of its same size*/
+		bool update(ui32 region, ui32 width, ui32 height, const ui8* data, ui32 channels) {
+			if (region >= regions.size() || regions[region].width != width || regions[region].height != height) return false;
+
+			regions[region].alpha = hasAlpha(width, height, data, channels);
+			upload(regions[region], data, channels);
+			return true;
+		}
+
+		ui32 regionCount() { return regions.size(); }
+		const Region& region(ui32 i) { return regions[i]; }
+		ui32 pageTexture(ui32 page) { return pages[page].texture; }
+		ui32 pageCount() { return pages.size(); }
+
+	private:
+		/*copies the image in the middle of a PADDING wider rgba buffer, the border repeats the nearest edge pixel*/
+		void upload(const Region& region, const ui8* data, ui32 channels) {
+			const ui32 w = region.width + 2 * PADDING;
+			const ui32 h = region.height + 2 * PADDING;
+			padded.resize(w * h * 4);
+
+			for (ui32 y = 0; y < h; y++) {
+				const ui32 srcY = y < PADDING ? 0 : (y - PADDING >= region.height ? region.height - 1 : y - PADDING);
+				for (ui32 x = 0; x < w; x++) {
+					const ui32 srcX = x < PADDING ? 0 : (x - PADDING >= region.width ? region.width - 1 : x - PADDING);
+					const ui8* src = data + (srcY * region.width + srcX) * channels;
+					ui8* dst = padded.data() + (y * w + x) * 4;
+
+					dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2];
+					dst[3] = channels == 4 ? src[3] : 255;
+				}
+			}
+
+			GLState::bindTexture(0, pages[region.page].name);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, region.x - PADDING, region.y - PADDING, w, h, GL_RGBA, GL_UNSIGNED_BYTE, padded.data());
+			FrameStats::textureUpload(padded.size());
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+	};
+}
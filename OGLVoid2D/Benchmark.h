@@ -0,0 +1,314 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "Renderer.h"
+
+/*define VOI_BENCHMARK_IMPLEMENTATION in one source file before including this header to count the allocations
+per frame, it replaces the global operator new / delete of the whole program with ones that count, so only do it
+in builds made for benchmarking*/
+
+namespace voi {
+	/*operator new calls since the program started, stays 0 without VOI_BENCHMARK_IMPLEMENTATION*/
+	inline std::atomic<ui64>& allocationCounter() {
+		static std::atomic<ui64> count{ 0 };
+		return count;
+	}
+
+	enum BenchmarkScenario : ui32 {
+		// n FillRect
+		BENCH_SOLID_RECTS,
+		// n TextureRect cycling through BENCH_TEXTURES textures
+		BENCH_TEXTURED_RECTS,
+		// one FillShape mesh of n triangles
+		BENCH_FILL_SHAPE,
+		// like BENCH_TEXTURED_RECTS with every texture replaced through ChangeTexture each frame
+		BENCH_TEXTURE_CHURN,
+		// n FillRect recorded once into a static layer
+		BENCH_STATIC_RECTS,
+		BENCH_SCENARIO_COUNT
+	};
+
+	struct BenchmarkResult {
+		BenchmarkScenario scenario;
+		ui32 n;
+		ui32 frames;
+		double primitivesPerSecond;
+		// sum of the FrameTimer phases
+		double cpuMsPerFrame;
+		double gpuMsPerFrame;
+		double allocationsPerFrame;
+		double drawCallsPerFrame;
+	};
+
+	/*runs every scenario at every size on one headless engine, each for warmupFrames frames that aren't measured
+	and measuredFrames that are, then writes the results as json. the scenes are deterministic so the numbers of
+	two commits can be compared when run on the same machine*/
+	class Benchmark : public VoiOGLEngine {
+		static const ui32 BENCH_TEXTURES = 8;
+		static const ui32 BENCH_TEXTURE_SIZE = 64;
+
+		std::vector<ui32> sizes;
+		ui32 warmupFrames;
+		ui32 measuredFrames;
+
+		std::vector<BenchmarkResult> results;
+		ui32 scenario = 0;
+		ui32 sizeIndex = 0;
+		ui32 frame = 0;
+
+		// sums over the measured frames
+		double cpuMs = 0;
+		ui64 drawCalls = 0;
+		// the gpu totals when the measured frames started, the frames read back since then are averaged
+		double startGpuMs = 0;
+		ui32 startGpuFrames = 0;
+		ui64 startAllocations = 0;
+		std::chrono::steady_clock::time_point start;
+
+		ui32 textures[BENCH_TEXTURES];
+		// two images per texture, the churn scenario swaps between them
+		std::vector<ui8> images[2];
+		ui32 staticLayer = 0;
+		std::vector<FillVertex2D> mesh;
+		std::vector<ui32> meshElements;
+
+	public:
+		Benchmark(const std::vector<ui32>& _sizes = { 1000, 10000, 100000 }, ui32 _warmupFrames = 10, ui32 _measuredFrames = 60)
+			: sizes(_sizes), warmupFrames(_warmupFrames < 5 ? 5 : _warmupFrames), measuredFrames(_measuredFrames > 0 ? _measuredFrames : 1) {}
+
+		/*runs the whole suite and writes it to "jsonPath", returns false when the engine or the file can't be created*/
+		bool run(const std::string& jsonPath, ui32 width = 800, ui32 height = 600) {
+			if (sizes.empty()) return false;
+
+			EngineConfig config;
+			config.headless = true;
+			config.frameTiming = true;
+			if (!Construct("VoiOGLEngine benchmark", width, height, config)) return false;
+			Start();
+
+			return writeJson(jsonPath, width, height);
+		}
+
+		const std::vector<BenchmarkResult>& getResults() { return results; }
+
+		static const char* scenarioName(BenchmarkScenario scenario) {
+			const char* names[] = { "solid_rects", "textured_rects", "fill_shape", "texture_churn", "static_rects" };
+			return scenario < BENCH_SCENARIO_COUNT ? names[scenario] : "unknown";
+		}
+
+	protected:
+		void Begin() override {
+			for (ui32 i = 0; i < 2; i++) {
+				images[i].resize(BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE * 4);
+				for (ui32 p = 0; p < BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE; p++) {
+					const bool checker = (((p % BENCH_TEXTURE_SIZE) / 8 + (p / BENCH_TEXTURE_SIZE) / 8 + i) % 2) == 0;
+					images[i][p * 4 + 0] = checker ? 255 : 40;
+					images[i][p * 4 + 1] = (ui8)(p * 7);
+					images[i][p * 4 + 2] = checker ? 40 : 255;
+					images[i][p * 4 + 3] = 255;
+				}
+			}
+			for (ui32 t = 0; t < BENCH_TEXTURES; t++) {
+				textures[t] = AddTexture(BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE, images[t % 2].data());
+			}
+
+			staticLayer = CreateStaticLayer();
+			SetStaticLayerVisible(staticLayer, false);
+		}
+
+		void Update(float deltaTime) override {
+			Clear();
+
+			if (frame == 0) BeginScenario();
+
+			/*the counters and timings read here are the ones of the frame before*/
+			if (frame > warmupFrames) Accumulate();
+			if (frame == warmupFrames) {
+				cpuMs = 0;
+				drawCalls = 0;
+				FrameTiming timing = GetFrameTiming();
+				startGpuMs = timing.gpuTotalMs;
+				startGpuFrames = timing.gpuFrames;
+				startAllocations = allocationCounter().load(std::memory_order_relaxed);
+				start = std::chrono::steady_clock::now();
+			}
+			if (frame == warmupFrames + measuredFrames) {
+				EndScenario();
+				if (!NextScenario()) {
+					Stop();
+					return;
+				}
+				BeginScenario();
+			}
+
+			DrawScenario();
+			frame++;
+		}
+
+		void Finish() override {}
+
+	private:
+		ui32 currentSize() { return sizes[sizeIndex]; }
+
+		void BeginScenario() {
+			frame = 0;
+			const ui32 n = currentSize();
+
+			SetStaticLayerVisible(staticLayer, scenario == BENCH_STATIC_RECTS);
+			if (scenario == BENCH_STATIC_RECTS) {
+				BeginStaticLayer(staticLayer);
+				for (ui32 i = 0; i < n; i++) DrawRect(i, n);
+				EndStaticLayer();
+			}
+			else InvalidateStaticLayer(staticLayer);
+
+			if (scenario == BENCH_FILL_SHAPE) BuildMesh(n);
+		}
+
+		void DrawScenario() {
+			const ui32 n = currentSize();
+
+			switch (scenario) {
+			case BENCH_SOLID_RECTS:
+				for (ui32 i = 0; i < n; i++) DrawRect(i, n);
+				break;
+			case BENCH_TEXTURE_CHURN:
+				for (ui32 t = 0; t < BENCH_TEXTURES; t++) {
+					ChangeTexture(textures[t], BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE, images[(t + frame) % 2].data());
+				}
+				// fallthrough
+			case BENCH_TEXTURED_RECTS:
+				drawColor = { 0 };
+				for (ui32 i = 0; i < n; i++) {
+					ChooseCurrentTextures(textures[i % BENCH_TEXTURES]);
+					float x, y, size;
+					Place(i, n, x, y, size);
+					TextureRect(x, y, size, size);
+				}
+				break;
+			case BENCH_FILL_SHAPE:
+				FillShape(mesh, meshElements);
+				break;
+			default:
+				break;
+			}
+		}
+
+		/*a grid with a cell per primitive covering the whole frame*/
+		static void Place(ui32 i, ui32 n, float& x, float& y, float& size) {
+			ui32 columns = 1;
+			while (columns * columns < n) columns++;
+			const float cell = 2.f / columns;
+
+			x = -1.f + (i % columns) * cell;
+			y = -1.f + (i / columns) * cell;
+			size = cell * 0.8f;
+		}
+
+		void DrawRect(ui32 i, ui32 n) {
+			drawColor = { (i % 7) / 6.f, (i % 11) / 10.f, (i % 13) / 12.f, 1.f };
+			float x, y, size;
+			Place(i, n, x, y, size);
+			FillRect(x, y, size, size);
+		}
+
+		/*a grid of quads, two triangles each, with n triangles in total*/
+		void BuildMesh(ui32 n) {
+			mesh.clear();
+			meshElements.clear();
+
+			const ui32 quads = (n + 1) / 2;
+			ui32 columns = 1;
+			while (columns * columns < quads) columns++;
+			const float cell = 2.f / columns;
+
+			for (ui32 q = 0; q < quads; q++) {
+				const float x = -1.f + (q % columns) * cell, y = -1.f + (q / columns) * cell;
+				const Pixel color = { (q % 5) / 4.f, (q % 3) / 2.f, 0.5f, 1.f };
+				const ui32 base = mesh.size();
+
+				mesh.emplace_back(Vec2f{ x, y }, color);
+				mesh.emplace_back(Vec2f{ x + cell, y }, color);
+				mesh.emplace_back(Vec2f{ x + cell, y + cell }, color);
+				mesh.emplace_back(Vec2f{ x, y + cell }, color);
+
+				const ui32 quad[] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+				meshElements.insert(meshElements.end(), quad, quad + (q * 2 + 1 < n ? 6 : 3));
+			}
+		}
+
+		void Accumulate() {
+			FrameTiming timing = GetFrameTiming();
+			for (ui32 p = 0; p < PHASE_COUNT; p++) cpuMs += timing.cpu[p].last;
+			drawCalls += GetFrameCounters().drawCalls;
+		}
+
+		void EndScenario() {
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			const ui64 allocations = allocationCounter().load(std::memory_order_relaxed) - startAllocations;
+			const ui32 n = currentSize();
+
+			BenchmarkResult result;
+			result.scenario = (BenchmarkScenario)scenario;
+			result.n = n;
+			result.frames = measuredFrames;
+			result.primitivesPerSecond = seconds > 0 ? (double)n * measuredFrames / seconds : 0;
+			result.cpuMsPerFrame = cpuMs / measuredFrames;
+			FrameTiming timing = GetFrameTiming();
+			const ui32 gpuFrames = timing.gpuFrames - startGpuFrames;
+			result.gpuMsPerFrame = gpuFrames > 0 ? (timing.gpuTotalMs - startGpuMs) / gpuFrames : 0;
+			result.allocationsPerFrame = (double)allocations / measuredFrames;
+			result.drawCallsPerFrame = (double)drawCalls / measuredFrames;
+			results.push_back(result);
+
+			printf("%-16s n %-8u %12.0f prims/s %8.3f cpu ms %8.3f gpu ms %8.1f allocs %6.1f draws\n", scenarioName(result.scenario), n,
+				result.primitivesPerSecond, result.cpuMsPerFrame, result.gpuMsPerFrame, result.allocationsPerFrame, result.drawCallsPerFrame);
+		}
+
+		/*sizes go up within a scenario, false once every scenario ran*/
+		bool NextScenario() {
+			if (++sizeIndex < sizes.size()) return true;
+			sizeIndex = 0;
+			return ++scenario < BENCH_SCENARIO_COUNT;
+		}
+
+		bool writeJson(const std::string& path, ui32 width, ui32 height) {
+			FILE* file = fopen(path.c_str(), "w");
+			if (file == NULL) return false;
+
+			fprintf(file, "{\n  \"width\": %u,\n  \"height\": %u,\n  \"warmupFrames\": %u,\n  \"measuredFrames\": %u,\n", width, height, warmupFrames, measuredFrames);
+			fprintf(file, "  \"allocationsCounted\": %s,\n  \"results\": [\n", allocationCounter().load() > 0 ? "true" : "false");
+			for (size_t i = 0; i < results.size(); i++) {
+				const BenchmarkResult& r = results[i];
+				fprintf(file, "    { \"scenario\": \"%s\", \"n\": %u, \"frames\": %u, \"primitivesPerSecond\": %.1f, \"cpuMsPerFrame\": %.4f, "
+					"\"gpuMsPerFrame\": %.4f, \"allocationsPerFrame\": %.2f, \"drawCallsPerFrame\": %.2f }%s\n",
+					scenarioName(r.scenario), r.n, r.frames, r.primitivesPerSecond, r.cpuMsPerFrame, r.gpuMsPerFrame,
+					r.allocationsPerFrame, r.drawCallsPerFrame, i + 1 < results.size() ? "," : "");
+			}
+			fprintf(file, "  ]\n}\n");
+
+			fclose(file);
+			return true;
+		}
+	};
+}
+
+#ifdef VOI_BENCHMARK_IMPLEMENTATION
+void* operator new(size_t size) {
+	voi::allocationCounter().fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = malloc(size > 0 ? size : 1)) return memory;
+	throw std::bad_alloc();
+}
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+#endif
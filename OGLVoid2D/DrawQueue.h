@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+
+#include "utilDefs.h"
+
+namespace voi {
+	/*one draw of a range of a batch, "first" and "count" are elements, or instances for instanced batches*/
+	struct DrawCommand {
+		ui64 key;
+		ui32 batch;
+		ui32 first;
+		ui32 count;
+	};
+
+	/*draw commands ordered by a 64 bit key, sorted with an lsd radix sort of 8 bits per pass,
+	passes where every key has the same byte are skipped*/
+	class DrawQueue {
+		std::vector<DrawCommand> commands;
+		std::vector<DrawCommand> scratch;
+		ui32 order = 0;
+
+	public:
+		static const ui32 DEPTH_BITS = 24;
+		static const ui32 ORDER_BITS = 23;
+
+		/*pass (1 bit) | depth (24) | program (8) | texture (8) | submission order (23), opaque depth goes front to back
+		and translucent back to front, equal keys up to the order keep the submission order. translucent keys rank the
+		order above program and texture, at the same depth blending has to follow the submission*/
+		static ui64 makeKey(bool translucent, float z, ui32 program, ui32 texture, ui32 order) {
+			const ui32 depthMax = (1u << DEPTH_BITS) - 1;
+
+			/*ndc z, -1 is the nearest*/
+			float d = (z + 1.f) * 0.5f;
+			d = d < 0.f ? 0.f : (d > 1.f ? 1.f : d);
+			ui32 depth = (ui32)(d * depthMax);
+			if (translucent) depth = depthMax - depth;
+
+			const ui64 submission = order & ((1u << ORDER_BITS) - 1);
+			const ui64 state = ((ui64)(program & 0xff) << 8) | (texture & 0xff);
+			return ((ui64)(translucent ? 1 : 0) << 63) |
+				((ui64)depth << 39) |
+				(translucent ? (submission << 16) | state : (state << 23) | submission);
+		}
+
+		void push(bool translucent, float z, ui32 program, ui32 texture, ui32 batch, ui32 first, ui32 count) {
+			commands.push_back({ makeKey(translucent, z, program, texture, order++), batch, first, count });
+		}
+
+		void sort() {
+			if (commands.size() < 2) return;
+			scratch.resize(commands.size());
+
+			for (ui32 shift = 0; shift < 64; shift += 8) {
+				size_t counts[256] = {};
+				for (const DrawCommand& command : commands) {
+					counts[(command.key >> shift) & 0xff]++;
+				}
+				if (counts[(commands[0].key >> shift) & 0xff] == commands.size()) continue;
+
+				size_t offset = 0;
+				for (size_t& count : counts) {
+					const size_t c = count;
+					count = offset;
+					offset += c;
+				}
+				for (const DrawCommand& command : commands) {
+					scratch[counts[(command.key >> shift) & 0xff]++] = command;
+				}
+				commands.swap(scratch);
+			}
+		}
+
+		const std::vector<DrawCommand>& sorted() { return commands; }
+		size_t size() { return commands.size(); }
+
+		void clear() {
+			commands.clear();
+			order = 0;
+		}
+	};
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+namespace voi {
+	/*bounded queue of frames between one producer and one consumer, the slots are reused so whatever a frame
+	allocated is kept for the next one. the producer fills acquire() and hands it over with submit(), the
+	consumer takes next() and gives it back with release(), acquire blocks while every slot is waiting or in use*/
+	template<typename T>
+	class FrameQueue {
+		std::vector<T> slots;
+		size_t head = 0;
+		size_t tail = 0;
+		// submitted and not released yet
+		size_t pending = 0;
+		// submitted and not taken by next() yet
+		size_t ready = 0;
+		bool closed = false;
+
+		std::mutex mutex;
+		std::condition_variable changed;
+
+	public:
+		FrameQueue(size_t capacity) : slots(capacity) {}
+
+		T* acquire() {
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this] { return pending < slots.size(); });
+			return &slots[tail];
+		}
+
+		void submit() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				tail = (tail + 1) % slots.size();
+				pending++;
+				ready++;
+			}
+			changed.notify_all();
+		}
+
+		/*the oldest submitted slot, null once the queue is closed and drained*/
+		T* next() {
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this] { return ready > 0 || closed; });
+			if (ready == 0) return nullptr;
+
+			ready--;
+			return &slots[head];
+		}
+
+		void release() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				head = (head + 1) % slots.size();
+				pending--;
+			}
+			changed.notify_all();
+		}
+
+		void close() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				closed = true;
+			}
+			changed.notify_all();
+		}
+	};
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+/*what the gl calls of one frame cost, counted where they are issued (GLState for binds, GAO for buffer writes,
+the batches for draws), every draw after the first of a frame is a batch break caused by:
+program - it uses another program than the draw before
+texture - same program, some texture was bound since the draw before
+capacity - same state, the geometry was split (16 bit chunks, quad element buffer, wide members, another batch)*/
+struct FrameCounters {
+	static const uint32_t MAX_GROUPS = 8;
+
+	uint64_t frame;
+
+	uint32_t drawCalls;
+	uint32_t programSwitches;
+	uint32_t textureBinds;
+	uint32_t vaoBinds;
+
+	uint64_t vertexBytes;
+	uint64_t elementBytes;
+	uint64_t textureBytes;
+
+	// filled by the engine, one entry per batch group, vertices are instance records for the sprite groups
+	uint32_t groupVertices[MAX_GROUPS];
+	uint32_t groupElements[MAX_GROUPS];
+
+	uint32_t programBreaks;
+	uint32_t textureBreaks;
+	uint32_t capacityBreaks;
+};
+
+class FrameStats {
+	struct State {
+		FrameCounters current;
+		FrameCounters last;
+		bool drawn = false;
+		bool programChanged = false;
+		bool texturesChanged = false;
+		// "last" is read from other threads than the drawing one
+		std::mutex lastMutex;
+
+		State() {
+			memset(&current, 0, sizeof(current));
+			memset(&last, 0, sizeof(last));
+		}
+	};
+
+	static State& state() {
+		static State stats;
+		return stats;
+	}
+
+public:
+	static FrameCounters& current() { return state().current; }
+	/*the counters of the last finished frame*/
+	static FrameCounters last() {
+		std::lock_guard<std::mutex> lock(state().lastMutex);
+		return state().last;
+	}
+
+	static void programSwitch() {
+		state().current.programSwitches++;
+		state().programChanged = true;
+	}
+	static void textureBind() {
+		state().current.textureBinds++;
+		state().texturesChanged = true;
+	}
+	static void vaoBind() { state().current.vaoBinds++; }
+
+	static void vertexUpload(uint64_t bytes) { state().current.vertexBytes += bytes; }
+	static void elementUpload(uint64_t bytes) { state().current.elementBytes += bytes; }
+	static void textureUpload(uint64_t bytes) { state().current.textureBytes += bytes; }
+
+	/*call right after each glDraw* / glMultiDraw* call*/
+	static void drawCall() {
+		State& s = state();
+		s.current.drawCalls++;
+
+		if (s.drawn) {
+			if (s.programChanged) s.current.programBreaks++;
+			else if (s.texturesChanged) s.current.textureBreaks++;
+			else s.current.capacityBreaks++;
+		}
+		s.drawn = true;
+		s.programChanged = false;
+		s.texturesChanged = false;
+	}
+
+	static void endFrame() {
+		State& s = state();
+		const uint64_t frame = s.current.frame;
+
+		{
+			std::lock_guard<std::mutex> lock(s.lastMutex);
+			s.last = s.current;
+		}
+		memset(&s.current, 0, sizeof(s.current));
+		s.current.frame = frame + 1;
+		s.drawn = false;
+	}
+};
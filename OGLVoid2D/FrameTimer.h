@@ -0,0 +1,239 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#include "utilDefs.h"
+
+namespace voi {
+	enum FramePhase : ui32 { PHASE_UPDATE, PHASE_UPLOAD, PHASE_DRAW, PHASE_PRESENT, PHASE_COUNT };
+	/*parts of PHASE_DRAW, zones 0 to 5 are the batch groups by their index, then the static layers and the translucent pass*/
+	enum DrawZone : ui32 { ZONE_LAYERS = 6, ZONE_TRANSLUCENT, DRAW_ZONE_COUNT };
+
+	/*the last WINDOW samples of a time, in milliseconds*/
+	class RollingStat {
+		static const ui32 WINDOW = 256;
+		float samples[WINDOW];
+		ui32 count = 0;
+		ui32 next = 0;
+		std::vector<float> sorted;
+
+	public:
+		void add(float ms) {
+			samples[next] = ms;
+			next = (next + 1) % WINDOW;
+			if (count < WINDOW) count++;
+		}
+
+		float last() { return count > 0 ? samples[(next + WINDOW - 1) % WINDOW] : 0.f; }
+
+		float average() {
+			if (count == 0) return 0.f;
+			float sum = 0.f;
+			for (ui32 i = 0; i < count; i++) sum += samples[i];
+			return sum / count;
+		}
+
+		/*nearest rank percentile, "p" from 0 to 100*/
+		float percentile(float p) {
+			if (count == 0) return 0.f;
+			sorted.assign(samples, samples + count);
+			const ui32 rank = (ui32)(p / 100.f * (count - 1) + 0.5f);
+			std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+			return sorted[rank];
+		}
+	};
+
+	/*milliseconds a phase took over the last frames, gpu times stay 0 for the phases the gpu doesn't run*/
+	struct PhaseTiming {
+		float last, average, p50, p95, p99;
+	};
+
+	struct FrameTiming {
+		PhaseTiming cpu[PHASE_COUNT];
+		PhaseTiming gpu[PHASE_COUNT];
+		// PHASE_DRAW split by DrawZone
+		PhaseTiming cpuDraw[DRAW_ZONE_COUNT];
+		PhaseTiming gpuDraw[DRAW_ZONE_COUNT];
+		// frames the numbers are taken from, the gpu ones lag LATENCY - 1 frames behind
+		ui32 samples;
+		// gpu time of the phases added up over every frame read back so far, and how many frames that is
+		double gpuTotalMs;
+		ui32 gpuFrames;
+	};
+
+	/*cpu time of each phase and draw zone with a high resolution clock and gpu time with GL_TIMESTAMP queries, a phase
+	can run several times a frame and its times add up. each frame's queries go to the next of LATENCY sets and are read
+	when that set comes around again, LATENCY - 1 frames after they were issued, only if their result is there by then,
+	so reading them never waits for the gpu*/
+	class FrameTimer {
+		typedef std::chrono::high_resolution_clock Clock;
+		static const ui32 LATENCY = 4;
+		// the phases, then the draw zones
+		static const ui32 SLOTS = PHASE_COUNT + DRAW_ZONE_COUNT;
+
+		struct GpuFrame {
+			// begin / end timestamp pairs in the order they were begun, "slots" says which phase or zone each pair timed
+			std::vector<ui32> queries;
+			std::vector<ui32> slots;
+			ui32 used = 0;
+			// the query issued last, timestamps arrive in the order they were issued
+			ui32 lastIssued = 0;
+			bool pending = false;
+		};
+
+		bool enabled = false;
+		bool gpu = false;
+
+		double cpuFrame[SLOTS] = {};
+		Clock::time_point cpuStart[SLOTS];
+		// the pair each open slot reserved in its frame, slots nest (zones inside PHASE_DRAW)
+		ui32 openQuery[SLOTS] = {};
+
+		GpuFrame gpuFrames[LATENCY];
+		ui32 gpuCurrent = 0;
+
+		RollingStat cpuStats[SLOTS];
+		RollingStat gpuStats[SLOTS];
+		ui32 samples = 0;
+		double gpuTotalMs = 0.0;
+		ui32 gpuFramesRead = 0;
+		// the stats are written at the end of the frame and read from whatever thread asks for them
+		std::mutex statsMutex;
+
+	public:
+		~FrameTimer() {
+			for (GpuFrame& frame : gpuFrames) {
+				if (!frame.queries.empty()) glDeleteQueries(frame.queries.size(), frame.queries.data());
+			}
+		}
+
+		/*"gpuQueries" needs a current context on the thread that calls begin / end / endFrame*/
+		void enable(bool gpuQueries) {
+			enabled = true;
+			gpu = gpuQueries;
+		}
+
+		bool isEnabled() { return enabled; }
+
+		void begin(FramePhase phase) { beginSlot(phase); }
+		void end(FramePhase phase) { endSlot(phase); }
+
+		/*zones are timed inside PHASE_DRAW, their times are part of it*/
+		void begin(DrawZone zone) { beginSlot(PHASE_COUNT + zone); }
+		void end(DrawZone zone) { endSlot(PHASE_COUNT + zone); }
+
+		/*time measured somewhere else, like Update on the simulation thread*/
+		void add(FramePhase phase, double seconds) {
+			if (enabled) cpuFrame[phase] += seconds;
+		}
+
+		void endFrame() {
+			if (!enabled) return;
+
+			{
+				std::lock_guard<std::mutex> lock(statsMutex);
+				for (ui32 s = 0; s < SLOTS; s++) {
+					cpuStats[s].add((float)(cpuFrame[s] * 1000.0));
+					cpuFrame[s] = 0.0;
+				}
+				samples++;
+			}
+
+			if (gpu) {
+				gpuFrames[gpuCurrent].pending = gpuFrames[gpuCurrent].used > 0;
+				gpuCurrent = (gpuCurrent + 1) % LATENCY;
+
+				/*the oldest frame is about to be reused, its results are kept only if they already arrived*/
+				GpuFrame& oldest = gpuFrames[gpuCurrent];
+				if (oldest.pending) readGpu(oldest);
+				oldest.pending = false;
+				oldest.used = 0;
+			}
+		}
+
+		FrameTiming timing() {
+			std::lock_guard<std::mutex> lock(statsMutex);
+
+			FrameTiming result;
+			for (ui32 p = 0; p < PHASE_COUNT; p++) {
+				result.cpu[p] = summary(cpuStats[p]);
+				result.gpu[p] = summary(gpuStats[p]);
+			}
+			for (ui32 z = 0; z < DRAW_ZONE_COUNT; z++) {
+				result.cpuDraw[z] = summary(cpuStats[PHASE_COUNT + z]);
+				result.gpuDraw[z] = summary(gpuStats[PHASE_COUNT + z]);
+			}
+			result.samples = samples;
+			result.gpuTotalMs = gpuTotalMs;
+			result.gpuFrames = gpuFramesRead;
+			return result;
+		}
+
+	private:
+		void beginSlot(ui32 slot) {
+			if (!enabled) return;
+			cpuStart[slot] = Clock::now();
+
+			if (gpu) {
+				GpuFrame& frame = gpuFrames[gpuCurrent];
+				if (frame.used + 2 > frame.queries.size()) {
+					const size_t previous = frame.queries.size();
+					frame.queries.resize(previous + 8);
+					glGenQueries(8, frame.queries.data() + previous);
+				}
+				openQuery[slot] = frame.used;
+				frame.slots.resize(frame.used / 2 + 1);
+				frame.slots[frame.used / 2] = slot;
+				frame.used += 2;
+
+				glQueryCounter(frame.queries[openQuery[slot]], GL_TIMESTAMP);
+				frame.lastIssued = openQuery[slot];
+			}
+		}
+
+		void endSlot(ui32 slot) {
+			if (!enabled) return;
+			cpuFrame[slot] += std::chrono::duration<double>(Clock::now() - cpuStart[slot]).count();
+
+			if (gpu) {
+				GpuFrame& frame = gpuFrames[gpuCurrent];
+				glQueryCounter(frame.queries[openQuery[slot] + 1], GL_TIMESTAMP);
+				frame.lastIssued = openQuery[slot] + 1;
+			}
+		}
+
+		void readGpu(GpuFrame& frame) {
+			GLint available = 0;
+			glGetQueryObjectiv(frame.queries[frame.lastIssued], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) return;
+
+			double slotTime[SLOTS] = {};
+			bool timed[SLOTS] = {};
+			for (ui32 i = 0; i < frame.used; i += 2) {
+				GLuint64 begin, end;
+				glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &begin);
+				glGetQueryObjectui64v(frame.queries[i + 1], GL_QUERY_RESULT, &end);
+
+				slotTime[frame.slots[i / 2]] += (end - begin) / 1e6;
+				timed[frame.slots[i / 2]] = true;
+			}
+
+			std::lock_guard<std::mutex> lock(statsMutex);
+			for (ui32 s = 0; s < SLOTS; s++) {
+				if (timed[s]) gpuStats[s].add((float)slotTime[s]);
+			}
+			/*the zones are inside PHASE_DRAW, only the phases make up the frame*/
+			for (ui32 p = 0; p < PHASE_COUNT; p++) gpuTotalMs += slotTime[p];
+			gpuFramesRead++;
+		}
+
+		static PhaseTiming summary(RollingStat& stat) {
+			return { stat.last(), stat.average(), stat.percentile(50.f), stat.percentile(95.f), stat.percentile(99.f) };
+		}
+	};
+}
@@ -3,11 +3,56 @@
 #include <iostream>
 #include <vector>
 #include <numeric>
+#include <string>
+#include <cstring>
 #include <glad/glad.h>
 #include "Lineal.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "FrameStats.h"
 
 #include "Pixel.h"
 
+/*buffer storage (4.4 / ARB_buffer_storage) is not part of the 3.3 loader, it is fetched at runtime by GAO::loadBufferStorage*/
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP PFNVOIBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+/*one vertex attribute, "count" components of "type", a plain number converts to that many floats,
+"normalized" maps integer types to [0,1] / [-1,1], "integer" keeps them as ints in the shader (glVertexAttribIPointer)*/
+struct VertexAttrib {
+	uint32_t count;
+	GLenum type;
+	bool normalized;
+	bool integer;
+
+	VertexAttrib(uint32_t _count, GLenum _type = GL_FLOAT, bool _normalized = false, bool _integer = false) :
+		count(_count), type(_type), normalized(_normalized), integer(_integer) {}
+
+	static size_t typeSize(GLenum type) {
+		switch (type) {
+		case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+		case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: return 2;
+		default: return 4;
+		}
+	}
+
+	/*attributes start 4 byte aligned*/
+	size_t size() const { return ((count * typeSize(type) + 3) / 4) * 4; }
+
+	static size_t stride(const std::vector<VertexAttrib>& attributes) {
+		size_t total = 0;
+		for (const auto& attrib : attributes) {
+			total += attrib.size();
+		}
+		return total;
+	}
+};
+
 class GAO {
 
 	const uint32_t COUNT;
@@ -16,15 +61,66 @@ class GAO {
 	uint32_t *VBOs = new uint32_t[COUNT];
 	uint32_t *EBOs = new uint32_t[COUNT];
 
+public:
 	struct BOsInfo {
 		size_t capacity = 0;
 		size_t size = 0;
 		GLenum usage = GL_DYNAMIC_DRAW;
+		/*biggest size the buffer has held since it was defined or trimmed*/
+		size_t highWater = 0;
 	};
 
+	/*capacity a buffer starts with when none is given, and the floor trims shrink to*/
+	static const size_t MIN_BUFFER_CAPACITY = 1000 * sizeof(uint32_t);
+
+	/*vertices a 16 bit element can reach, and the quads the shared quad element buffer holds*/
+	static const uint32_t MAX_SHORT_VERTICES = 65536;
+	static const uint32_t QUADS_PER_ELEMENT_BUFFER = MAX_SHORT_VERTICES / 4;
+	/*dirty ranges closer than this many bytes are uploaded as one, a gap this small costs less than another call*/
+	static const size_t DIRTY_MERGE_GAP = 256;
+
+	struct ByteRange {
+		size_t begin;
+		size_t end;
+	};
+
+private:
 	BOsInfo *VBOsInfo = new BOsInfo[COUNT];
 	BOsInfo *EBOsInfo = new BOsInfo[COUNT];
 
+	static const uint32_t MAX_STREAM_SEGMENTS = 4;
+
+	// a streamed vertex buffer is split in segments (one per frame in flight), each frame writes to the next segment
+	// straight through a mapped pointer, a fence per segment keeps the cpu from writing where the gpu still reads
+	struct StreamInfo {
+		bool enabled = false;
+		bool persistent = false;
+		uint32_t segments = 0;
+		uint32_t current = 0;
+		size_t segmentCapacity = 0;
+		size_t stride = 0;
+		uint8_t *mapped = nullptr;
+		size_t mappedOffset = 0;
+		GLsync fences[MAX_STREAM_SEGMENTS] = {};
+	};
+
+	StreamInfo *VBOsStream = new StreamInfo[COUNT];
+	std::vector<VertexAttrib> *VBOsLayout = new std::vector<VertexAttrib>[COUNT];
+	/*byte offset the attribute pointers were last set to, instanced draws move it instead of using a base vertex*/
+	size_t *VBOsPointed = new size_t[COUNT]();
+	/*sorted, non overlapping byte ranges modified since the last flush*/
+	std::vector<ByteRange> *VBOsDirty = new std::vector<ByteRange>[COUNT];
+
+	// element buffer shared by every vao that only holds quads, filled once with 16 bit 0,1,2 2,3,0 for each quad
+	// of a 64K vertex range, bigger quad batches draw it again with a higher base vertex
+	uint32_t quadEBO = 0;
+	bool *quadBound = new bool[COUNT]();
+
+	static PFNVOIBUFFERSTORAGEPROC& bufferStorage() {
+		static PFNVOIBUFFERSTORAGEPROC proc = nullptr;
+		return proc;
+	}
+
 public:
 	GAO(uint32_t count): COUNT(count){
 
@@ -32,17 +128,28 @@ public:
 		glGenBuffers(COUNT, VBOs);
 		glGenBuffers(COUNT, EBOs);
 		for (int i = 0; i < COUNT; i++) {
-			glBindVertexArray(VAOs[i]);
+			GLState::bindVertexArray(VAOs[i]);
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOs[i]);
 		}
 	}
 	~GAO() {
+		if (VBOsStream != nullptr) {
+			for (uint32_t i = 0; i < COUNT; i++) {
+				releaseStream(i);
+			}
+			delete[] VBOsStream;
+		}
+		if (VBOsLayout != nullptr) delete[] VBOsLayout;
+		if (VBOsPointed != nullptr) delete[] VBOsPointed;
+		if (VBOsDirty != nullptr) delete[] VBOsDirty;
 		if (VAOs != nullptr) {
 			glDeleteVertexArrays(COUNT, VAOs);
+			GLState::vertexArraysDeleted(COUNT, VAOs);
 			delete[] VAOs;
 		}
 		if (VBOs != nullptr) {
 			glDeleteBuffers(COUNT, VBOs);
+			GLState::buffersDeleted(COUNT, VBOs);
 			delete[] VBOs;
 		}
 		if (EBOs != nullptr) {
@@ -52,6 +159,26 @@ public:
 
 		if (VBOsInfo != nullptr) delete[] VBOsInfo;
 		if (EBOsInfo != nullptr) delete[] EBOsInfo;
+
+		if (quadEBO != 0) glDeleteBuffers(1, &quadEBO);
+		if (quadBound != nullptr) delete[] quadBound;
+	}
+
+	/*fetches glBufferStorage when the context supports it, streamed buffers then stay persistently mapped*/
+	static bool loadBufferStorage(GLADloadproc load) {
+		bool supported = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4);
+
+		if (!supported) {
+			int extCount = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &extCount);
+			for (int e = 0; e < extCount && !supported; e++) {
+				const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, e);
+				supported = ext != nullptr && std::string(ext) == "GL_ARB_buffer_storage";
+			}
+		}
+
+		bufferStorage() = supported ? (PFNVOIBUFFERSTORAGEPROC)load("glBufferStorage") : nullptr;
+		return bufferStorage() != nullptr;
 	}
 
 	uint32_t getVAO(uint32_t i) {
@@ -75,7 +202,7 @@ public:
 
 	void bindVao(uint32_t i){
 		if (i < COUNT) {
-			glBindVertexArray(VAOs[i]);
+			GLState::bindVertexArray(VAOs[i]);
 		}
 		else {
 			throw "Outside of range Exception";
@@ -83,7 +210,7 @@ public:
 	}
 	void bindBuffer(uint32_t i) {
 		if (i < COUNT) {
-			glBindBuffer(GL_ARRAY_BUFFER, VBOs[i]);
+			GLState::bindArrayBuffer(VBOs[i]);
 		}
 		else {
 			throw "Outside of range Exception";
@@ -91,8 +218,8 @@ public:
 	}
 	void bind(uint32_t i) {
 		if (i < COUNT) {
-			glBindVertexArray(VAOs[i]);
-			glBindBuffer(GL_ARRAY_BUFFER, VBOs[i]);
+			GLState::bindVertexArray(VAOs[i]);
+			GLState::bindArrayBuffer(VBOs[i]);
 		}
 		else {
 			throw "Outside of range Exception";
@@ -110,29 +237,94 @@ public:
 		}
 	}
 
-	void setElBufferData(uint32_t i, const std::vector<uint32_t>& elData, GLenum usage, bool resize = false) {
+	/*makes every attribute of the vao advance once per "divisor" instances instead of once per vertex*/
+	void setDivisor(uint32_t i, uint32_t divisor) {
 		if (i < COUNT) {
 			bindVao(i);
+			for (uint32_t a = 0; a < VBOsLayout[i].size(); a++) {
+				glVertexAttribDivisor(a, divisor);
+			}
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	/*points the attributes at "firstVertex", for draws that can't take a base vertex (instanced ones in 3.3)*/
+	void offsetAttributes(uint32_t i, uint32_t firstVertex) {
+		if (i < COUNT) {
+			const size_t offset = firstVertex * VertexAttrib::stride(VBOsLayout[i]);
+			if (offset != VBOsPointed[i]) {
+				bind(i);
+				pointAttributes(i, offset);
+			}
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	void setElBufferData(uint32_t i, const std::vector<uint32_t>& elData, GLenum usage, bool resize = false) {
+		setElBufferData(i, elData.data(), elData.size(), usage, resize);
+	}
+
+	void setElBufferData(uint32_t i, const uint32_t* elData, size_t elCount, GLenum usage, bool resize = false) {
+		setElBufferBytes(i, elData, elCount * sizeof(uint32_t), usage, resize);
+	}
+
+	void setElBufferData(uint32_t i, const uint16_t* elData, size_t elCount, GLenum usage, bool resize = false) {
+		setElBufferBytes(i, elData, elCount * sizeof(uint16_t), usage, resize);
+	}
+
+	/*the element type is the caller's choice, the buffer only keeps bytes. a usage other than the buffer's reallocates it*/
+	void setElBufferBytes(uint32_t i, const void* elData, size_t newSize, GLenum usage, bool resize = false) {
+		VOI_PROFILE_ZONE("GAO::setElBufferBytes");
+		if (i < COUNT) {
+			useOwnElements(i);
 
 			const size_t prevCapacity = EBOsInfo[i].capacity;
-			const size_t newSize = elData.size() * sizeof(uint32_t);
 
-			if (resize || newSize != prevCapacity) {
-				if (newSize < 1000 * sizeof(uint32_t)) {
-					glBufferData(GL_ELEMENT_ARRAY_BUFFER, 1000 * sizeof(uint32_t), elData.data(), EBOsInfo[i].usage);
-					EBOsInfo[i].capacity = 1000 * sizeof(uint32_t);
-					EBOsInfo[i].size = newSize;
-				}
-				else {
-					glBufferData(GL_ELEMENT_ARRAY_BUFFER, newSize, elData.data(), EBOsInfo[i].usage);
-					EBOsInfo[i].capacity = newSize;
-					EBOsInfo[i].size = newSize;
+			if (resize || newSize > prevCapacity || usage != EBOsInfo[i].usage) {
+				const size_t newCapacity = resize ? newSize : grownCapacity(prevCapacity, newSize);
+
+				EBOsInfo[i].usage = usage;
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, newCapacity, NULL, usage);
+				EBOsInfo[i].capacity = newCapacity;
+			}
+
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, newSize, elData);
+			FrameStats::elementUpload(newSize);
+			EBOsInfo[i].size = newSize;
+			if (newSize > EBOsInfo[i].highWater) EBOsInfo[i].highWater = newSize;
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	/*binds the shared quad element buffer (GL_UNSIGNED_SHORT, QUADS_PER_ELEMENT_BUFFER quads) to the vao*/
+	void useQuadElements(uint32_t i) {
+		if (i < COUNT) {
+			bindVao(i);
+
+			if (quadEBO == 0) {
+				std::vector<uint16_t> quads(QUADS_PER_ELEMENT_BUFFER * 6);
+				for (uint32_t q = 0; q < QUADS_PER_ELEMENT_BUFFER; q++) {
+					const uint16_t v = q * 4;
+					uint16_t* e = quads.data() + q * 6;
+					e[0] = v; e[1] = v + 1; e[2] = v + 2;
+					e[3] = v + 2; e[4] = v + 3; e[5] = v;
 				}
 
+				/*uploaded through the copy target, the element target belongs to whatever vao is bound*/
+				glGenBuffers(1, &quadEBO);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, quadEBO);
+				glBufferData(GL_COPY_WRITE_BUFFER, quads.size() * sizeof(uint16_t), quads.data(), GL_STATIC_DRAW);
 			}
-			else {
-				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, newSize, elData.data());
-				EBOsInfo[i].size = newSize;
+
+			if (!quadBound[i]) {
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadEBO);
+				quadBound[i] = true;
 			}
 		}
 		else {
@@ -140,17 +332,67 @@ public:
 		}
 	}
 
-	void defineVerBufferData(uint32_t i, const std::vector<uint32_t>& attributes, GLenum usage = GL_DYNAMIC_DRAW, uint32_t size = 1000, const std::vector<float>& vertData = {}) {
+	/*binds the vao with its own element buffer back, undoing useQuadElements*/
+	void useOwnElements(uint32_t i) {
 		if (i < COUNT) {
-			bind(i);
+			bindVao(i);
+
+			if (quadBound[i]) {
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOs[i]);
+				quadBound[i] = false;
+			}
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
 
-			uint32_t total = std::accumulate(attributes.begin(), attributes.end(), 0);
-			uint32_t sum = 0;
-			for (uint32_t i = 0; i < attributes.size(); i++) {
-				glVertexAttribPointer(i, attributes[i], GL_FLOAT, GL_FALSE, total * sizeof(float), (void*)(sum * sizeof(float)));
-				sum += attributes[i];
+	/*shrinks the element buffer to its current size, the only way its capacity goes down*/
+	void trimElBufferData(uint32_t i) {
+		if (i < COUNT) {
+			useOwnElements(i);
+
+			const size_t size = EBOsInfo[i].size;
+			const size_t newCapacity = size > MIN_BUFFER_CAPACITY ? size : MIN_BUFFER_CAPACITY;
+
+			if (newCapacity < EBOsInfo[i].capacity) {
+				/*the elements are kept so the batch can still be redrawn without uploading them again*/
+				const uint32_t prevBuffer = EBOs[i];
+				glGenBuffers(1, &EBOs[i]);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOs[i]);
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, newCapacity, NULL, EBOsInfo[i].usage);
+
+				if (size > 0) {
+					glBindBuffer(GL_COPY_READ_BUFFER, prevBuffer);
+					glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ELEMENT_ARRAY_BUFFER, 0, 0, size);
+				}
+				glDeleteBuffers(1, &prevBuffer);
 
+				EBOsInfo[i].capacity = newCapacity;
 			}
+			EBOsInfo[i].highWater = size;
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	const BOsInfo& getElBufferInfo(uint32_t i) {
+		if (i < COUNT) {
+			return EBOsInfo[i];
+		}
+		throw "Outside of range Exception";
+	}
+
+	void defineVerBufferData(uint32_t i, const std::vector<VertexAttrib>& attributes, GLenum usage = GL_DYNAMIC_DRAW, uint32_t size = 1000, const std::vector<float>& vertData = {}) {
+		if (i < COUNT) {
+			releaseStream(i);
+			bind(i);
+
+			VBOsLayout[i] = attributes;
+			pointAttributes(i);
+
+			const size_t stride = VertexAttrib::stride(attributes);
 
 			void *data;
 
@@ -166,7 +408,7 @@ public:
 			}
 			else {
 				VBOsInfo[i] = {
-					size * total * sizeof(float),
+					size * stride,
 					0,
 					usage
 				};
@@ -183,7 +425,73 @@ public:
 		}
 	}
 
+	/*defines a vertex buffer as a ring of "frames" segments of "size" vertices each, see StreamInfo*/
+	void defineVerStreamData(uint32_t i, const std::vector<VertexAttrib>& attributes, uint32_t size = 1000, uint32_t frames = 3) {
+		if (i < COUNT) {
+			defineVerBufferData(i, attributes, GL_STREAM_DRAW, 0);
+
+			StreamInfo& stream = VBOsStream[i];
+
+			stream.enabled = true;
+			stream.segments = frames < 1 ? 1 : (frames > MAX_STREAM_SEGMENTS ? MAX_STREAM_SEGMENTS : frames);
+			stream.current = 0;
+			stream.stride = VertexAttrib::stride(attributes);
+
+			VBOsInfo[i] = {
+				0,
+				0,
+				GL_STREAM_DRAW
+			};
+
+			reallocateVerBuffer(i, size * stream.stride);
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	bool isStreamed(uint32_t i) {
+		if (i < COUNT) {
+			return VBOsStream[i].enabled;
+		}
+		return false;
+	}
+
+	/*closes the cpu writes of the current segment, returns the base vertex the draw has to use*/
+	int32_t prepareVerDraw(uint32_t i) {
+		if (i < COUNT) {
+			StreamInfo& stream = VBOsStream[i];
+			if (!stream.enabled) return 0;
+
+			if (stream.mapped != nullptr && !stream.persistent) {
+				bindBuffer(i);
+				glUnmapBuffer(GL_ARRAY_BUFFER);
+				stream.mapped = nullptr;
+			}
+
+			return (int32_t)((stream.current * stream.segmentCapacity) / stream.stride);
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	/*marks the current segment as in use by the gpu, call after the draws that read it*/
+	void fenceVerDraw(uint32_t i) {
+		if (i < COUNT) {
+			StreamInfo& stream = VBOsStream[i];
+			if (!stream.enabled || VBOsInfo[i].size == 0) return;
+
+			if (stream.fences[stream.current] != nullptr) glDeleteSync(stream.fences[stream.current]);
+			stream.fences[stream.current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
 	void setVerBufferData(uint32_t i, const std::vector<float>& vertData, bool resize = false) {
+		VOI_PROFILE_ZONE("GAO::setVerBufferData");
 		if (i < COUNT) {
 			bindBuffer(i);
 
@@ -191,15 +499,18 @@ public:
 			const size_t newSize = vertData.size() * sizeof(float);
 
 			if (resize || newSize > prevCapacity) {
-				glBufferData(GL_ARRAY_BUFFER, newSize, vertData.data(), VBOsInfo[i].usage);
-				VBOsInfo[i].capacity = newSize;
-				VBOsInfo[i].size = newSize;
-			}
-			else {
-				glBufferSubData(GL_ARRAY_BUFFER, 0, newSize, vertData.data());
-				VBOsInfo[i].size = newSize;
+				const size_t newCapacity = resize ? newSize : grownCapacity(prevCapacity, newSize);
+
+				glBufferData(GL_ARRAY_BUFFER, newCapacity, NULL, VBOsInfo[i].usage);
+				VBOsInfo[i].capacity = newCapacity;
 			}
 
+			glBufferSubData(GL_ARRAY_BUFFER, 0, newSize, vertData.data());
+			FrameStats::vertexUpload(newSize);
+			VBOsInfo[i].size = newSize;
+			VBOsDirty[i].clear();
+			if (newSize > VBOsInfo[i].highWater) VBOsInfo[i].highWater = newSize;
+
 		}
 		else {
 			throw "Outside of range Exception";
@@ -207,28 +518,147 @@ public:
 	}
 
 	void addVerBufferData(uint32_t i, const std::vector<float>& vertData) {
+		addVerBufferData(i, vertData.data(), vertData.size() * sizeof(float));
+	}
+
+	/*appends "addedSize" bytes after the ones already in the buffer*/
+	void addVerBufferData(uint32_t i, const void* vertData, size_t addedSize) {
+		VOI_PROFILE_ZONE("GAO::addVerBufferData");
 		if (i < COUNT) {
-			bindBuffer(i);
 			const size_t size = VBOsInfo[i].size;
 			const size_t capacity = VBOsInfo[i].capacity;
 
-			const size_t addedSize = vertData.size() * sizeof(float);
-			if (size + addedSize <= capacity) {
-				glBufferSubData(GL_ARRAY_BUFFER, size, addedSize, vertData.data());
-				VBOsInfo[i].size = size + addedSize;
+			if (size + addedSize > capacity) {
+				reallocateVerBuffer(i, grownCapacity(capacity, size + addedSize));
+			}
+
+			if (VBOsStream[i].enabled) {
+				uint8_t* dst = mapStream(i);
+				memcpy(dst + (size - VBOsStream[i].mappedOffset), vertData, addedSize);
 			}
 			else {
-				throw "Run out of allocated buffer capacity";
+				bindBuffer(i);
+				glBufferSubData(GL_ARRAY_BUFFER, size, addedSize, vertData);
+			}
+			FrameStats::vertexUpload(addedSize);
+
+			VBOsInfo[i].size = size + addedSize;
+			if (VBOsInfo[i].size > VBOsInfo[i].highWater) VBOsInfo[i].highWater = VBOsInfo[i].size;
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	/*rewrites "size" bytes at "offset" of what the buffer already holds*/
+	void updateVerBufferData(uint32_t i, size_t offset, const void* vertData, size_t size) {
+		VOI_PROFILE_ZONE("GAO::updateVerBufferData");
+		if (i < COUNT) {
+			if (VBOsStream[i].enabled) throw "Streamed buffers can't be updated in place";
+			if (offset + size > VBOsInfo[i].size) throw "Outside of range Exception";
+
+			bindBuffer(i);
+			glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertData);
+			FrameStats::vertexUpload(size);
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	/*records that bytes [offset, offset + size) of the caller's copy changed, overlapping or close ranges are merged*/
+	void markVerBufferDirty(uint32_t i, size_t offset, size_t size) {
+		if (i < COUNT) {
+			if (VBOsStream[i].enabled) throw "Streamed buffers can't be updated in place";
+			if (size == 0) return;
+
+			std::vector<ByteRange>& dirty = VBOsDirty[i];
+			ByteRange range = { offset, offset + size };
+
+			/*first range that could touch the new one, everything before it ends too early*/
+			size_t first = 0;
+			while (first < dirty.size() && dirty[first].end + DIRTY_MERGE_GAP < range.begin) first++;
+
+			size_t last = first;
+			while (last < dirty.size() && dirty[last].begin <= range.end + DIRTY_MERGE_GAP) {
+				if (dirty[last].begin < range.begin) range.begin = dirty[last].begin;
+				if (dirty[last].end > range.end) range.end = dirty[last].end;
+				last++;
+			}
+
+			dirty.erase(dirty.begin() + first, dirty.begin() + last);
+			dirty.insert(dirty.begin() + first, range);
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	/*uploads the dirty ranges from "source", the caller's copy of the whole buffer, the parts past the
+	buffer's current size are dropped since they haven't been added yet*/
+	void flushVerBufferData(uint32_t i, const void* source) {
+		VOI_PROFILE_ZONE("GAO::flushVerBufferData");
+		if (i < COUNT) {
+			std::vector<ByteRange>& dirty = VBOsDirty[i];
+			if (dirty.empty()) return;
+
+			bindBuffer(i);
+			for (const ByteRange& range : dirty) {
+				if (range.begin >= VBOsInfo[i].size) break;
+
+				const size_t end = range.end < VBOsInfo[i].size ? range.end : VBOsInfo[i].size;
+				glBufferSubData(GL_ARRAY_BUFFER, range.begin, end - range.begin, (const uint8_t*)source + range.begin);
+				FrameStats::vertexUpload(end - range.begin);
+			}
+			dirty.clear();
+		}
+		else {
+			throw "Outside of range Exception";
+		}
+	}
+
+	const std::vector<ByteRange>& getVerDirtyRanges(uint32_t i) {
+		if (i < COUNT) {
+			return VBOsDirty[i];
+		}
+		throw "Outside of range Exception";
+	}
+
+	/*shrinks the vertex buffer (each segment when streamed) to its current size, keeping its contents*/
+	void trimVerBufferData(uint32_t i) {
+		if (i < COUNT) {
+			size_t newCapacity = VBOsInfo[i].size > MIN_BUFFER_CAPACITY ? VBOsInfo[i].size : MIN_BUFFER_CAPACITY;
+			if (VBOsStream[i].enabled) {
+				const size_t stride = VBOsStream[i].stride;
+				newCapacity = ((newCapacity + stride - 1) / stride) * stride;
+			}
+
+			if (newCapacity < VBOsInfo[i].capacity) {
+				reallocateVerBuffer(i, newCapacity);
 			}
+			VBOsInfo[i].highWater = VBOsInfo[i].size;
 		}
 		else {
 			throw "Outside of range Exception";
 		}
 	}
 
+	const BOsInfo& getVerBufferInfo(uint32_t i) {
+		if (i < COUNT) {
+			return VBOsInfo[i];
+		}
+		throw "Outside of range Exception";
+	}
+
 	void clearVerBufferData(uint32_t i) {
 		if (i < COUNT) {
+			StreamInfo& stream = VBOsStream[i];
+			if (stream.enabled && VBOsInfo[i].size > 0) {
+				prepareVerDraw(i);
+				stream.current = (stream.current + 1) % stream.segments;
+			}
 			VBOsInfo[i].size = 0;
+			VBOsDirty[i].clear();
 		}
 		else {
 			throw "Outside of range Exception";
@@ -236,4 +666,156 @@ public:
 	}
 
 private:
+	/*capacities double until they fit, so a batch that keeps growing reallocates a logarithmic number of times*/
+	static size_t grownCapacity(size_t capacity, size_t needed) {
+		size_t newCapacity = capacity > MIN_BUFFER_CAPACITY ? capacity : MIN_BUFFER_CAPACITY;
+		while (newCapacity < needed) {
+			newCapacity *= 2;
+		}
+		return newCapacity;
+	}
+
+	/*moves the vertex buffer to new storage of "capacity" bytes (per segment when streamed),
+	the bytes written so far are copied gpu side with glCopyBufferSubData*/
+	void reallocateVerBuffer(uint32_t i, size_t capacity) {
+		VOI_PROFILE_ZONE("GAO::reallocateVerBuffer");
+		StreamInfo& stream = VBOsStream[i];
+		const size_t size = VBOsInfo[i].size;
+		/*segments hold whole vertices, prepareVerDraw divides their offset by the stride to get the base vertex*/
+		const size_t newCapacity = stream.enabled ? ((capacity + stream.stride - 1) / stream.stride) * stream.stride : capacity;
+		const size_t segments = stream.enabled ? stream.segments : 1;
+		const size_t prevOffset = stream.enabled ? stream.current * stream.segmentCapacity : 0;
+		const size_t newOffset = stream.enabled ? stream.current * newCapacity : 0;
+
+		if (stream.mapped != nullptr && !stream.persistent) {
+			bindBuffer(i);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		stream.mapped = nullptr;
+
+		const uint32_t prevBuffer = VBOs[i];
+		glGenBuffers(1, &VBOs[i]);
+		bind(i);
+		pointAttributes(i);
+
+		stream.persistent = stream.enabled && bufferStorage() != nullptr;
+		if (stream.persistent) {
+			bufferStorage()(GL_ARRAY_BUFFER, newCapacity * segments, NULL, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+		}
+		else {
+			glBufferData(GL_ARRAY_BUFFER, newCapacity * segments, NULL, VBOsInfo[i].usage);
+		}
+
+		const size_t kept = size < newCapacity ? size : newCapacity;
+		if (kept > 0) {
+			glBindBuffer(GL_COPY_READ_BUFFER, prevBuffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, VBOs[i]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, prevOffset, newOffset, kept);
+		}
+		/*a persistent mapping goes away with the buffer, the gpu keeps the storage alive while draws still read it*/
+		glDeleteBuffers(1, &prevBuffer);
+		GLState::buffersDeleted(1, &prevBuffer);
+
+		/*the fences guarded the previous storage, nothing reads the new one yet*/
+		for (auto& fence : stream.fences) {
+			if (fence != nullptr) glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		if (stream.persistent) {
+			stream.mapped = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0, newCapacity * segments, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+			stream.mappedOffset = 0;
+		}
+		if (stream.enabled) stream.segmentCapacity = newCapacity;
+
+		VBOsInfo[i].capacity = newCapacity;
+		VBOsInfo[i].size = kept;
+	}
+
+	/*returns the pointer where the byte "mappedOffset" of the current segment is written*/
+	uint8_t* mapStream(uint32_t i) {
+		StreamInfo& stream = VBOsStream[i];
+		const size_t size = VBOsInfo[i].size;
+
+		if (size == 0) waitStream(i);
+
+		if (stream.persistent) {
+			stream.mappedOffset = 0;
+			return stream.mapped + stream.current * stream.segmentCapacity;
+		}
+
+		if (stream.mapped == nullptr) {
+			bindBuffer(i);
+			stream.mapped = (uint8_t*)glMapBufferRange(
+				GL_ARRAY_BUFFER,
+				stream.current * stream.segmentCapacity + size,
+				stream.segmentCapacity - size,
+				GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+			);
+			stream.mappedOffset = size;
+		}
+
+		return stream.mapped;
+	}
+
+	void waitStream(uint32_t i) {
+		VOI_PROFILE_ZONE("GAO::waitStream");
+		StreamInfo& stream = VBOsStream[i];
+		GLsync& fence = stream.fences[stream.current];
+
+		if (fence != nullptr) {
+			GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			while (result == GL_TIMEOUT_EXPIRED) {
+				result = glClientWaitSync(fence, 0, 1000000);
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	/*the vao stores the buffer name per attribute, so this has to run again whenever the name changes*/
+	void pointAttributes(uint32_t i, size_t offset = 0) {
+		const std::vector<VertexAttrib>& attributes = VBOsLayout[i];
+
+		const GLsizei stride = (GLsizei)VertexAttrib::stride(attributes);
+		size_t sum = 0;
+		for (uint32_t a = 0; a < attributes.size(); a++) {
+			const VertexAttrib& attrib = attributes[a];
+			if (attrib.integer) {
+				glVertexAttribIPointer(a, attrib.count, attrib.type, stride, (void*)(offset + sum));
+			}
+			else {
+				glVertexAttribPointer(a, attrib.count, attrib.type, attrib.normalized ? GL_TRUE : GL_FALSE, stride, (void*)(offset + sum));
+			}
+			sum += attrib.size();
+		}
+		VBOsPointed[i] = offset;
+	}
+
+	/*immutable storage can't be reallocated, the buffer gets a new name instead*/
+	void renameBuffer(uint32_t i) {
+		glDeleteBuffers(1, &VBOs[i]);
+		GLState::buffersDeleted(1, &VBOs[i]);
+		glGenBuffers(1, &VBOs[i]);
+		bind(i);
+		pointAttributes(i);
+	}
+
+	void releaseStream(uint32_t i) {
+		StreamInfo& stream = VBOsStream[i];
+
+		if (stream.mapped != nullptr) {
+			bindBuffer(i);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		for (auto& fence : stream.fences) {
+			if (fence != nullptr) glDeleteSync(fence);
+		}
+
+		if (stream.persistent) {
+			renameBuffer(i);
+		}
+
+		stream = StreamInfo();
+	}
 };
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+#include "FrameStats.h"
+
+/*remembers what the current context has bound so binding the same object again costs no gl call, every
+program, vao, array buffer, texture and depth/blend change of the engine goes through here.
+element buffer bindings are vao state and stay with the GAO, call invalidate() after raw gl calls that bind anything*/
+class GLState {
+	static const uint32_t UNKNOWN = 0xffffffff;
+	static const uint32_t MAX_UNITS = 64;
+
+	struct Cache {
+		uint32_t program = UNKNOWN;
+		uint32_t vao = UNKNOWN;
+		uint32_t arrayBuffer = UNKNOWN;
+		uint32_t activeUnit = UNKNOWN;
+		uint32_t textures[MAX_UNITS];
+
+		int depthTest = -1;
+		int depthWrite = -1;
+		int blend = -1;
+		GLenum depthFunc = 0;
+		GLenum blendSrc = 0;
+		GLenum blendDst = 0;
+
+		Cache() {
+			for (auto& texture : textures) texture = UNKNOWN;
+		}
+	};
+
+	static Cache& cache() {
+		static Cache state;
+		return state;
+	}
+
+public:
+	static void useProgram(uint32_t id) {
+		if (cache().program != id) {
+			glUseProgram(id);
+			cache().program = id;
+			FrameStats::programSwitch();
+		}
+	}
+
+	static void bindVertexArray(uint32_t id) {
+		if (cache().vao != id) {
+			glBindVertexArray(id);
+			cache().vao = id;
+			FrameStats::vaoBind();
+		}
+	}
+
+	static void bindArrayBuffer(uint32_t id) {
+		if (cache().arrayBuffer != id) {
+			glBindBuffer(GL_ARRAY_BUFFER, id);
+			cache().arrayBuffer = id;
+		}
+	}
+
+	static void activeTexture(uint32_t unit) {
+		if (cache().activeUnit != unit) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			cache().activeUnit = unit;
+		}
+	}
+
+	/*binds a 2D texture to "unit", units past MAX_UNITS are always bound*/
+	static void bindTexture(uint32_t unit, uint32_t id) {
+		if (unit < MAX_UNITS && cache().textures[unit] == id) return;
+
+		activeTexture(unit);
+		glBindTexture(GL_TEXTURE_2D, id);
+		if (unit < MAX_UNITS) cache().textures[unit] = id;
+		FrameStats::textureBind();
+	}
+
+	static void setDepthTest(bool enabled) {
+		if (cache().depthTest != (int)enabled) {
+			if (enabled) glEnable(GL_DEPTH_TEST);
+			else glDisable(GL_DEPTH_TEST);
+			cache().depthTest = enabled;
+		}
+	}
+
+	static void setDepthFunc(GLenum func) {
+		if (cache().depthFunc != func) {
+			glDepthFunc(func);
+			cache().depthFunc = func;
+		}
+	}
+
+	static void setDepthWrite(bool enabled) {
+		if (cache().depthWrite != (int)enabled) {
+			glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+			cache().depthWrite = enabled;
+		}
+	}
+
+	static void setBlend(bool enabled) {
+		if (cache().blend != (int)enabled) {
+			if (enabled) glEnable(GL_BLEND);
+			else glDisable(GL_BLEND);
+			cache().blend = enabled;
+		}
+	}
+
+	static void setBlendFunc(GLenum src, GLenum dst) {
+		if (cache().blendSrc != src || cache().blendDst != dst) {
+			glBlendFunc(src, dst);
+			cache().blendSrc = src;
+			cache().blendDst = dst;
+		}
+	}
+
+	/*gl unbinds deleted objects, these keep the cache in line after a glDelete* of a possibly bound name*/
+	static void buffersDeleted(uint32_t count, const uint32_t* ids) {
+		for (uint32_t i = 0; i < count; i++) {
+			if (cache().arrayBuffer == ids[i]) cache().arrayBuffer = 0;
+		}
+	}
+
+	static void vertexArraysDeleted(uint32_t count, const uint32_t* ids) {
+		for (uint32_t i = 0; i < count; i++) {
+			if (cache().vao == ids[i]) cache().vao = 0;
+		}
+	}
+
+	static void invalidate() { cache() = Cache(); }
+};
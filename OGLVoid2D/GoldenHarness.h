@@ -0,0 +1,424 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+
+#include "Renderer.h"
+#include "SoftRasterizer.h"
+
+namespace voi {
+	/*a scripted scene, "draw" records frame "frame" (0 to frames - 1) and the last one is compared with the golden image.
+	a budget of 0 isn't checked*/
+	struct GoldenScene {
+		std::string name;
+		std::function<void(CommandBuffer&, ui32 frame)> draw;
+		ui32 frames = 3;
+		// most draw calls any frame of the scene may take
+		ui32 maxDrawCalls = 0;
+		// average cpu milliseconds (every FrameTimer phase) of the scene's frames
+		float maxFrameMs = 0;
+	};
+
+	struct GoldenResult {
+		std::string name;
+		// the golden image was missing or being updated and got written instead of compared
+		bool recorded = false;
+		bool imagePassed = false;
+		bool budgetPassed = false;
+		// the gl image against SoftRasterizer drawing the same CommandBuffer
+		bool referencePassed = false;
+		// the gpu time of PHASE_DRAW holds the draw zones timed inside it
+		bool timingPassed = false;
+		// with the render thread, the Reserve views refused to write the batches from Update
+		bool guardPassed = false;
+		ui32 differentPixels = 0;
+		ui32 maxChannelDiff = 0;
+		ui32 referencePixels = 0;
+		ui32 drawCalls = 0;
+		float frameMs = 0;
+	};
+
+	/*runs each scene on a headless engine of its own and checks it against "<directory>/<name>.ppm", a pixel differs
+	when one of its rgb channels is more than "tolerance" away, a scene passes when at most "maxDifferentPixels" differ.
+	failing scenes leave "<name>.actual.ppm" and "<name>.diff.ppm" next to the golden. goldens are binary ppm, rows
+	from the top, recorded when missing or with "update" set. the last frame is also drawn by SoftRasterizer and
+	compared with "referenceTolerance", its filtering isn't bit exact, so a golden recorded from a broken gl path
+	doesn't pass, "<name>.reference.ppm" is left when they differ*/
+	class GoldenHarness {
+		static const ui32 GOLDEN_TEXTURE_SIZE = 32;
+
+		/*draws one scene, its last frame is read back in Finish, where the context is current with or without the
+		render thread*/
+		class SceneEngine : public VoiOGLEngine {
+			GoldenHarness& harness;
+			const GoldenScene& golden;
+			const bool threaded;
+			// the reference clamps the textures the atlas takes, only when there is an atlas
+			const bool atlas;
+			ui32 frame = 0;
+			ui32 commands = 0;
+			SoftRasterizer* reference = nullptr;
+
+		public:
+			std::vector<ui8> image;
+			std::vector<ui8> referenceImage;
+			ui32 drawCalls = 0;
+			double frameMs = 0;
+			bool timingNested = false;
+			bool reserveGuarded = false;
+
+			SceneEngine(GoldenHarness& _harness, const GoldenScene& _golden, const EngineConfig& config) :
+				harness(_harness), golden(_golden), threaded(config.renderThread), atlas(config.atlasTextures),
+				reserveGuarded(!config.renderThread) {}
+
+		protected:
+			void Begin() override {
+				reference = new SoftRasterizer(GetFrameWidth(), GetFrameHeight());
+				AddTextures();
+
+				commands = CreateCommandBuffer();
+				SetClearColor({ 0.2f, 0.3f, 0.3f, 1.f });
+			}
+
+			void Update(float deltaTime) override {
+				/*counters and timings read here belong to a frame before*/
+				if (frame > 0) Measure();
+
+				if (threaded && frame == 0) {
+					try {
+						ReserveFillQuads(1);
+					}
+					catch (const char*) {
+						reserveGuarded = true;
+					}
+				}
+
+				Clear();
+				CommandBuffer& buffer = GetCommandBuffer(commands);
+				golden.draw(buffer, frame);
+				frame++;
+				if (frame < golden.frames) return;
+
+				/*the buffer is emptied when submitted, the frame is still drawn after Stop*/
+				reference->clear(GetClearColor());
+				reference->draw(buffer);
+				reference->readPixels(referenceImage);
+				Stop();
+			}
+
+			void Finish() override {
+				Measure();
+				ReadPixels(image);
+
+				/*the zones are disjoint parts of PHASE_DRAW, in the frame the gpu numbers were last read from*/
+				FrameTiming timing = GetFrameTiming();
+				float zones = 0.f;
+				for (ui32 z = 0; z < DRAW_ZONE_COUNT; z++) zones += timing.gpuDraw[z].last;
+				timingNested = zones <= timing.gpu[PHASE_DRAW].last + 1e-5f;
+
+				delete reference;
+				reference = nullptr;
+			}
+
+		private:
+			/*the same handles on every engine, since each one starts with an empty atlas*/
+			void AddTextures() {
+				std::vector<ui8> pixels(GOLDEN_TEXTURE_SIZE * GOLDEN_TEXTURE_SIZE * 4);
+				for (ui32 t = 0; t < 2; t++) {
+					for (ui32 p = 0; p < GOLDEN_TEXTURE_SIZE * GOLDEN_TEXTURE_SIZE; p++) {
+						const ui32 x = p % GOLDEN_TEXTURE_SIZE, y = p / GOLDEN_TEXTURE_SIZE;
+						pixels[p * 4 + 0] = (ui8)(x * 8);
+						pixels[p * 4 + 1] = (ui8)(y * 8);
+						pixels[p * 4 + 2] = ((x / 4 + y / 4) % 2) * 255;
+						pixels[p * 4 + 3] = t == 1 && (x / 8 + y / 8) % 2 ? 96 : 255;
+					}
+					harness.textures[t] = AddTexture(GOLDEN_TEXTURE_SIZE, GOLDEN_TEXTURE_SIZE, pixels.data());
+					reference->setTexture(harness.textures[t], GOLDEN_TEXTURE_SIZE, GOLDEN_TEXTURE_SIZE, pixels.data(), 4,
+						atlas && TextureAtlas::fits(GOLDEN_TEXTURE_SIZE, GOLDEN_TEXTURE_SIZE));
+				}
+
+				const ui32 big = TextureAtlas::MAX_REGION_SIZE + 44;
+				pixels.resize(big * big * 4);
+				for (ui32 p = 0; p < big * big; p++) {
+					pixels[p * 4 + 0] = (ui8)((p % big) * 255 / big);
+					pixels[p * 4 + 1] = 128;
+					pixels[p * 4 + 2] = (ui8)((p / big) * 255 / big);
+					pixels[p * 4 + 3] = 255;
+				}
+				harness.textures[2] = AddTexture(big, big, pixels.data());
+				reference->setTexture(harness.textures[2], big, big, pixels.data(), 4, atlas && TextureAtlas::fits(big, big));
+			}
+
+			void Measure() {
+				const ui32 calls = GetFrameCounters().drawCalls;
+				if (calls > drawCalls) drawCalls = calls;
+
+				FrameTiming timing = GetFrameTiming();
+				for (ui32 p = 0; p < PHASE_COUNT; p++) frameMs += timing.cpu[p].last;
+			}
+		};
+
+		std::vector<GoldenScene> scenes;
+		std::vector<GoldenResult> results;
+		std::string directory;
+		// added to the image names, the configs that sample differently keep goldens of their own
+		std::string variant;
+		bool update = false;
+		ui32 tolerance = 2;
+		ui32 maxDifferentPixels = 0;
+		ui32 referenceTolerance = 12;
+
+		ui32 textures[3];
+
+	public:
+		void addScene(const GoldenScene& golden) { scenes.push_back(golden); }
+
+		/*textures the scenes can draw with: 0 opaque, 1 with translucent texels, 2 too big for the atlas*/
+		ui32 texture(ui32 i) { return textures[i < 3 ? i : 0]; }
+
+		void setTolerance(ui32 channelTolerance, ui32 differentPixels, ui32 referenceChannelTolerance = 12) {
+			tolerance = channelTolerance;
+			maxDifferentPixels = differentPixels;
+			referenceTolerance = referenceChannelTolerance;
+		}
+
+		/*false when a scene failed or an engine couldn't start, "config" is made headless and timed, the same goldens
+		should pass with any of its paths (render thread, streaming, multi draw...). without atlasTextures the textures
+		repeat at their edges instead of clamping, those runs check "<scene>.noatlas.ppm"*/
+		bool run(const std::string& goldenDirectory, bool updateGoldens = false, const EngineConfig& config = EngineConfig(),
+			ui32 width = 320, ui32 height = 240) {
+			directory = goldenDirectory;
+			variant = config.atlasTextures ? "" : ".noatlas";
+			update = updateGoldens;
+			results.clear();
+
+			EngineConfig sceneConfig = config;
+			sceneConfig.headless = true;
+			sceneConfig.frameTiming = true;
+			sceneConfig.maxFrames = 0;
+
+			bool passed = true;
+			for (const GoldenScene& golden : scenes) {
+				SceneEngine engine(*this, golden, sceneConfig);
+				if (!engine.Construct("VoiOGLEngine golden", width, height, sceneConfig)) return false;
+				engine.Start();
+
+				const GoldenResult& result = Check(golden, engine, width, height);
+				if (!result.imagePassed || !result.budgetPassed || !result.referencePassed || !result.timingPassed || !result.guardPassed) passed = false;
+			}
+			return passed;
+		}
+
+		const std::vector<GoldenResult>& getResults() { return results; }
+
+		/*scenes covering each batching path, sprites, texture switches, translucency and 16 bit element chunks. the
+		frame budgets are a few times what a software gl driver takes, they catch a path going slow, not a slow machine*/
+		void addDefaultScenes() {
+			GoldenScene rects;
+			rects.name = "solid_rects";
+			rects.maxDrawCalls = 2;
+			rects.maxFrameMs = 40;
+			rects.draw = [](CommandBuffer& c, ui32) {
+				for (ui32 i = 0; i < 400; i++) {
+					c.drawColor = { (i % 7) / 6.f, (i % 5) / 4.f, (i % 3) / 2.f, 1.f };
+					c.FillRect(-1.f + (i % 20) * 0.1f, -1.f + (i / 20) * 0.1f, 0.15f, 0.15f, (i % 4) * 0.1f);
+				}
+			};
+			addScene(rects);
+
+			GoldenScene textured;
+			textured.name = "mixed_textures";
+			textured.maxDrawCalls = 4;
+			textured.maxFrameMs = 40;
+			textured.draw = [this](CommandBuffer& c, ui32) {
+				for (ui32 i = 0; i < 64; i++) {
+					const float x = -1.f + (i % 8) * 0.25f, y = -1.f + (i / 8) * 0.25f;
+					if (i % 3 == 2) {
+						c.drawColor = { 0.9f, 0.4f, 0.1f, 1.f };
+						c.FillRect(x, y, 0.2f, 0.2f, 0.1f);
+						continue;
+					}
+					c.drawColor = { 0.f, 0.f, 0.f, 0.f };
+					c.ChooseCurrentTextures(texture(i % 2 == 0 ? 0 : 2));
+					c.TextureRect(x, y, 0.2f, 0.2f, 0.1f);
+				}
+			};
+			addScene(textured);
+
+			GoldenScene translucent;
+			translucent.name = "translucent";
+			translucent.maxDrawCalls = 6;
+			translucent.maxFrameMs = 40;
+			translucent.draw = [this](CommandBuffer& c, ui32) {
+				c.drawColor = { 0.1f, 0.2f, 0.8f, 1.f };
+				c.FillRect(-0.8f, -0.8f, 1.6f, 1.6f, 0.5f);
+				for (ui32 i = 0; i < 6; i++) {
+					c.drawColor = { i / 5.f, 1.f - i / 5.f, 0.5f, 0.4f };
+					c.FillRect(-0.9f + i * 0.2f, -0.5f + i * 0.1f, 0.6f, 0.6f, 0.4f - i * 0.1f);
+				}
+				c.drawColor = { 0.f, 0.f, 0.f, 0.f };
+				c.ChooseCurrentTextures(texture(1));
+				c.TextureRect(-0.2f, -0.2f, 0.8f, 0.8f, -0.5f);
+				c.TextureTri({ -1.f, 0.5f }, { 0.f, 0.5f }, { -0.5f, 1.f }, 0.2f);
+			};
+			addScene(translucent);
+
+			GoldenScene shapes;
+			shapes.name = "shapes";
+			shapes.maxDrawCalls = 4;
+			shapes.maxFrameMs = 40;
+			shapes.draw = [this](CommandBuffer& c, ui32) {
+				std::vector<FillVertex2D> hex;
+				c.drawColor = { 0.f, 1.f, 0.f, 1.f };
+				for (ui32 k = 0; k < 6; k++) {
+					const float a = k * F_PI / 3;
+					hex.emplace_back(Vec2f{ -0.5f + 0.3f * cosf(a), 0.3f * sinf(a) }, Pixel{ k / 5.f, 1.f, 0.f, 1.f });
+				}
+				const ui32 fan[] = { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 5 };
+				c.FillShape(hex.data(), hex.size(), fan, 12);
+
+				c.drawColor = { 1.f, 1.f, 0.f, 1.f };
+				c.FillTriangle({ 0.1f, -0.9f }, { 0.9f, -0.9f }, { 0.5f, -0.2f }, 0.1f);
+				c.FillQuad({ 0.1f, 0.1f }, { 0.9f, 0.2f }, { 0.8f, 0.9f }, { 0.2f, 0.8f }, -0.1f);
+
+				c.drawColor = { 0.f, 0.f, 0.f, 0.f };
+				c.ChooseCurrentTextures(texture(0));
+				c.TextureQuad({ -0.9f, -0.9f }, { -0.2f, -0.8f }, { -0.3f, -0.3f }, { -0.8f, -0.4f }, 0.f);
+			};
+			addScene(shapes);
+
+			GoldenScene chunks;
+			chunks.name = "element_chunks";
+			chunks.maxDrawCalls = 4;
+			chunks.maxFrameMs = 150;
+			chunks.draw = [](CommandBuffer& c, ui32) {
+				/*more than 65536 vertices, split in 16 bit chunks*/
+				for (ui32 i = 0; i < 20000; i++) {
+					const float x = -1.f + (i % 200) * 0.01f, y = -1.f + (i / 200) * 0.02f;
+					c.drawColor = { (i % 200) / 199.f, (i / 200) / 99.f, 0.3f, 1.f };
+					c.FillQuad({ x, y }, { x + 0.009f, y }, { x + 0.009f, y + 0.018f }, { x, y + 0.018f });
+				}
+			};
+			addScene(chunks);
+		}
+
+	private:
+		const GoldenResult& Check(const GoldenScene& golden, const SceneEngine& engine, ui32 width, ui32 height) {
+			GoldenResult result;
+			result.name = golden.name;
+			result.drawCalls = engine.drawCalls;
+			result.timingPassed = engine.timingNested;
+			result.guardPassed = engine.reserveGuarded;
+			result.frameMs = (float)(engine.frameMs / golden.frames);
+			result.budgetPassed = (golden.maxDrawCalls == 0 || result.drawCalls <= golden.maxDrawCalls) &&
+				(golden.maxFrameMs <= 0 || result.frameMs <= golden.maxFrameMs);
+
+			const std::vector<ui8>& actual = engine.image;
+			const std::vector<ui8>& referenceImage = engine.referenceImage;
+			const std::string base = directory + "/" + golden.name + variant;
+			const std::string path = base + ".ppm";
+
+			std::vector<ui8> referenceDiff;
+			ui32 referenceMax = 0;
+			result.referencePixels = Compare(actual, referenceImage, width * height, referenceTolerance, referenceDiff, referenceMax);
+			result.referencePassed = result.referencePixels <= maxDifferentPixels;
+			if (!result.referencePassed) WritePpm(base + ".reference.ppm", referenceImage, width, height);
+
+			std::vector<ui8> expected;
+			ui32 goldenWidth = 0, goldenHeight = 0;
+			if (update || !ReadPpm(path, expected, goldenWidth, goldenHeight)) {
+				/*an image the reference disagrees with isn't worth keeping*/
+				result.recorded = result.referencePassed && WritePpm(path, actual, width, height);
+				result.imagePassed = result.recorded;
+			}
+			else if (goldenWidth != width || goldenHeight != height) {
+				result.differentPixels = width * height;
+				result.imagePassed = false;
+			}
+			else {
+				std::vector<ui8> diff;
+				result.differentPixels = Compare(actual, expected, width * height, tolerance, diff, result.maxChannelDiff);
+				result.imagePassed = result.differentPixels <= maxDifferentPixels;
+
+				if (!result.imagePassed) {
+					WritePpm(base + ".actual.ppm", actual, width, height);
+					WritePpm(base + ".diff.ppm", diff, width, height);
+				}
+			}
+
+			printf("%-16s %-8s %8u px differ (max %3u) %6u from reference%s %4u draws%s %8.3f ms%s%s%s\n", golden.name.c_str(),
+				result.recorded ? "recorded" : (result.imagePassed ? "ok" : "FAILED"),
+				result.differentPixels, result.maxChannelDiff,
+				result.referencePixels, result.referencePassed ? "" : " FAILED",
+				result.drawCalls, golden.maxDrawCalls > 0 && result.drawCalls > golden.maxDrawCalls ? " OVER BUDGET" : "",
+				result.frameMs, golden.maxFrameMs > 0 && result.frameMs > golden.maxFrameMs ? " OVER BUDGET" : "",
+				result.timingPassed ? "" : " ZONES OUTSIDE DRAW", result.guardPassed ? "" : " RESERVED FROM UPDATE");
+			results.push_back(result);
+			return results.back();
+		}
+
+		/*pixels of "actual" more than "channelTolerance" away from "expected" on a rgb channel, "diff" gets them in red
+		over a dimmed copy of "expected"*/
+		static ui32 Compare(const std::vector<ui8>& actual, const std::vector<ui8>& expected, ui32 pixels, ui32 channelTolerance,
+			std::vector<ui8>& diff, ui32& maxChannelDiff) {
+			ui32 different = 0;
+			diff.resize(pixels * 4);
+			for (ui32 i = 0; i < pixels; i++) {
+				ui32 pixelDiff = 0;
+				for (ui32 k = 0; k < 3; k++) {
+					const ui32 d = (ui32)abs((i32)actual[i * 4 + k] - (i32)expected[i * 4 + k]);
+					if (d > pixelDiff) pixelDiff = d;
+				}
+				if (pixelDiff > maxChannelDiff) maxChannelDiff = pixelDiff;
+
+				const bool differs = pixelDiff > channelTolerance;
+				if (differs) different++;
+				diff[i * 4 + 0] = differs ? 255 : expected[i * 4 + 0] / 4;
+				diff[i * 4 + 1] = differs ? 0 : expected[i * 4 + 1] / 4;
+				diff[i * 4 + 2] = differs ? 0 : expected[i * 4 + 2] / 4;
+				diff[i * 4 + 3] = 255;
+			}
+			return different;
+		}
+
+		static bool WritePpm(const std::string& path, const std::vector<ui8>& rgba, ui32 width, ui32 height) {
+			FILE* file = fopen(path.c_str(), "wb");
+			if (file == NULL) return false;
+
+			fprintf(file, "P6\n%u %u\n255\n", width, height);
+			for (ui32 i = 0; i < width * height; i++) fwrite(&rgba[i * 4], 1, 3, file);
+			fclose(file);
+			return true;
+		}
+
+		/*binary ppm into rgba, false when the file is missing or isn't one*/
+		static bool ReadPpm(const std::string& path, std::vector<ui8>& rgba, ui32& width, ui32& height) {
+			FILE* file = fopen(path.c_str(), "rb");
+			if (file == NULL) return false;
+
+			ui32 maxValue = 0;
+			const bool header = fscanf(file, "P6 %u %u %u", &width, &height, &maxValue) == 3 && maxValue == 255;
+			if (!header || fgetc(file) == EOF) {
+				fclose(file);
+				return false;
+			}
+
+			std::vector<ui8> rgb(width * height * 3);
+			const bool complete = fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+			fclose(file);
+			if (!complete) return false;
+
+			rgba.resize(width * height * 4);
+			for (ui32 i = 0; i < width * height; i++) {
+				rgba[i * 4 + 0] = rgb[i * 3 + 0];
+				rgba[i * 4 + 1] = rgb[i * 3 + 1];
+				rgba[i * 4 + 2] = rgb[i * 3 + 2];
+				rgba[i * 4 + 3] = 255;
+			}
+			return true;
+		}
+	};
+}
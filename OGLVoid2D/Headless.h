@@ -0,0 +1,173 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#ifdef VOI_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
+
+#include <chrono>
+
+#include "utilDefs.h"
+#include "GLState.h"
+
+namespace voi {
+	/*gl context without a visible window, everything is drawn into a framebuffer object of the requested size.
+	with VOI_HEADLESS_EGL defined (link EGL) the context comes from EGL, surfaceless when the driver supports it
+	(mesa's llvmpipe does), so it runs without a display or gpu. otherwise it's a hidden glfw window, which still
+	needs a desktop session*/
+	class HeadlessContext {
+		bool created = false;
+		ui32 width = 0;
+		ui32 height = 0;
+
+		ui32 framebuffer = 0;
+		ui32 colorBuffer = 0;
+		ui32 depthBuffer = 0;
+
+		std::chrono::steady_clock::time_point start;
+
+#ifdef VOI_HEADLESS_EGL
+		EGLDisplay display = EGL_NO_DISPLAY;
+		EGLContext context = EGL_NO_CONTEXT;
+		// a 1x1 pbuffer when the config has one, EGL_NO_SURFACE on surfaceless contexts
+		EGLSurface surface = EGL_NO_SURFACE;
+#else
+		GLFWwindow* window = NULL;
+#endif
+
+	public:
+		~HeadlessContext() { destroy(); }
+
+		/*creates the context and makes it current on the calling thread, returns false when it can't*/
+		bool create(ui32 _width, ui32 _height) {
+			width = _width;
+			height = _height;
+
+#ifdef VOI_HEADLESS_EGL
+			const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+			PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+			if (clientExtensions != NULL && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != NULL && getPlatformDisplay != NULL) {
+				display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+			}
+			if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+			if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) return false;
+
+			if (!eglBindAPI(EGL_OPENGL_API)) return false;
+
+			const EGLint configAttribs[] = {
+				EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+				EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+				EGL_NONE
+			};
+			EGLConfig config = NULL;
+			EGLint configCount = 0;
+			if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount)) configCount = 0;
+
+			/*surfaceless platforms may have no pbuffer configs, the framebuffer object is all it draws to anyway*/
+			const char* displayExtensions = eglQueryString(display, EGL_EXTENSIONS);
+			const bool surfaceless = displayExtensions != NULL && strstr(displayExtensions, "EGL_KHR_surfaceless_context") != NULL;
+			if (configCount == 0) {
+				if (!surfaceless || strstr(displayExtensions, "EGL_KHR_no_config_context") == NULL) return false;
+				config = EGL_NO_CONFIG_KHR;
+			}
+
+			const EGLint contextAttribs[] = {
+				EGL_CONTEXT_MAJOR_VERSION, 3,
+				EGL_CONTEXT_MINOR_VERSION, 3,
+				EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+				EGL_NONE
+			};
+			context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+			if (context == EGL_NO_CONTEXT) return false;
+
+			if (configCount > 0 && !surfaceless) {
+				const EGLint surfaceAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+				surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+				if (surface == EGL_NO_SURFACE) return false;
+			}
+#else
+			glfwInit();
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+			glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+			window = glfwCreateWindow(1, 1, "", NULL, NULL);
+			if (window == NULL) return false;
+#endif
+
+			created = true;
+			start = std::chrono::steady_clock::now();
+			makeCurrent(true);
+			return true;
+		}
+
+		GLADloadproc loader() {
+#ifdef VOI_HEADLESS_EGL
+			return (GLADloadproc)eglGetProcAddress;
+#else
+			return (GLADloadproc)glfwGetProcAddress;
+#endif
+		}
+
+		/*creates and binds the framebuffer everything is drawn to, needs glad loaded*/
+		bool createFramebuffer() {
+			glGenFramebuffers(1, &framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+			glGenRenderbuffers(1, &colorBuffer);
+			glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+			glGenRenderbuffers(1, &depthBuffer);
+			glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+			return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		}
+
+		/*binds the context to the calling thread, or releases it from it, the GLState cache is dropped when
+		binding since it may describe another context*/
+		void makeCurrent(bool current) {
+			if (!created) return;
+#ifdef VOI_HEADLESS_EGL
+			if (current) eglMakeCurrent(display, surface, surface, context);
+			else eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+#else
+			glfwMakeContextCurrent(current ? window : NULL);
+#endif
+			if (current) GLState::invalidate();
+		}
+
+		/*nothing to swap, the frame is only handed to the driver*/
+		void present() { glFlush(); }
+
+		/*seconds since the context was created*/
+		double time() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+
+		bool isCreated() { return created; }
+		ui32 getWidth() { return width; }
+		ui32 getHeight() { return height; }
+
+		void destroy() {
+			if (!created) return;
+			created = false;
+
+#ifdef VOI_HEADLESS_EGL
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+			eglDestroyContext(display, context);
+			eglTerminate(display);
+#else
+			glfwDestroyWindow(window);
+			glfwTerminate();
+#endif
+		}
+	};
+}
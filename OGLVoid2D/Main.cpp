@@ -13,6 +13,13 @@
 #include "Lineal.h"
 #include "GAO.h"
 #include "Renderer.h"
+/*counting the benchmark's allocations replaces the global operator new, builds that define VOI_COUNT_ALLOCATIONS
+are the only ones doing it*/
+#ifdef VOI_COUNT_ALLOCATIONS
+#define VOI_BENCHMARK_IMPLEMENTATION
+#endif
+#include "Benchmark.h"
+#include "GoldenHarness.h"
 #include "utilDefs.h"
 #include <random>
 
@@ -126,7 +133,33 @@ class Testing : public voi::VoiOGLEngine {
 	}
 };
 
-int main() {
+/*"--benchmark [results.json]" runs the benchmark suite headless instead of the test window (counting allocations with
+VOI_COUNT_ALLOCATIONS),
+"--golden <dir> [--update]" checks the golden scenes against the images in dir (recording missing ones) and
+against SoftRasterizer drawing the same commands, once as configured by default, then with the render thread, with fixed
+steps and without the texture atlas, the goldens of the repository are in "golden"*/
+int main(int argc, char** argv) {
+	if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+		voi::Benchmark benchmark;
+		return benchmark.run(argc > 2 ? argv[2] : "benchmark.json") ? 0 : 1;
+	}
+	if (argc > 2 && std::string(argv[1]) == "--golden") {
+		voi::GoldenHarness golden;
+		golden.addDefaultScenes();
+		const bool passed = golden.run(argv[2], argc > 3 && std::string(argv[3]) == "--update");
+
+		voi::EngineConfig threaded;
+		threaded.renderThread = true;
+		const bool threadPassed = golden.run(argv[2], false, threaded);
+
+		voi::EngineConfig stepped;
+		stepped.fixedStep = 1.0 / 60.0;
+		const bool stepPassed = golden.run(argv[2], false, stepped);
+
+		voi::EngineConfig unpacked;
+		unpacked.atlasTextures = false;
+		return golden.run(argv[2], false, unpacked) && stepPassed && threadPassed && passed ? 0 : 1;
+	}
 
 	std::cout << "FillVertex2D: " << sizeof(voi::FillVertex2D) << "; Vec2f: " << sizeof(voi::Vec2f) << "; Pixel: " << sizeof(voi::Pixel) << ";\n";
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstring>
+
 #include "utilDefs.h"
 
 namespace voi {
@@ -14,6 +16,19 @@ namespace voi {
 			};
 		};
 
+		/*the color as 4 bytes r, g, b, a in memory order, for GL_UNSIGNED_BYTE normalized attributes*/
+		ui32 packRGBA8() const {
+			ui8 bytes[4];
+			for (int i = 0; i < 4; i++) {
+				const float c = p[i] < 0.f ? 0.f : (p[i] > 1.f ? 1.f : p[i]);
+				bytes[i] = (ui8)(c * 255.f + 0.5f);
+			}
+
+			ui32 packed;
+			memcpy(&packed, bytes, sizeof(packed));
+			return packed;
+		}
+
 		static Pixel lerp(Pixel a, Pixel b, float t) {
 			return {
 				a.r + (b.r - a.r) * t,
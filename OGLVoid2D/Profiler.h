@@ -0,0 +1,147 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <cstdio>
+
+#include "utilDefs.h"
+
+/*VOI_PROFILE_ZONE("name") times the rest of the enclosing scope, VOI_PROFILE_THREAD("name") names the calling thread
+in the trace. both compile to nothing unless VOI_PROFILE is defined, the names must be string literals*/
+#ifdef VOI_PROFILE
+#define VOI_PROFILE_CONCAT_(a, b) a##b
+#define VOI_PROFILE_CONCAT(a, b) VOI_PROFILE_CONCAT_(a, b)
+#define VOI_PROFILE_ZONE(name) voi::ProfileZone VOI_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define VOI_PROFILE_THREAD(name) voi::Profiler::nameThread(name)
+#else
+#define VOI_PROFILE_ZONE(name)
+#define VOI_PROFILE_THREAD(name)
+#endif
+
+namespace voi {
+	/*zones recorded into one ring buffer per thread, a thread only writes its own buffer so recording takes no locks,
+	the oldest zones are overwritten once a buffer is full. writeChromeTrace exports them as trace event json
+	(chrome://tracing, perfetto), call it while the recording threads are idle, like in Finish*/
+	class Profiler {
+	public:
+		static const ui32 ZONES_PER_THREAD = 1 << 16;
+
+		struct Zone {
+			const char* name;
+			// nanoseconds since the profiler started
+			ui64 begin;
+			ui64 duration;
+		};
+
+	private:
+		struct ThreadBuffer {
+			ui32 id;
+			const char* name = nullptr;
+			std::vector<Zone> zones;
+			std::atomic<ui64> written{ 0 };
+
+			ThreadBuffer(ui32 _id) : id(_id), zones(ZONES_PER_THREAD) {}
+		};
+
+		struct Registry {
+			std::mutex mutex;
+			// never freed, a thread's zones stay exportable after it ends
+			std::vector<ThreadBuffer*> buffers;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		};
+
+		static Registry& registry() {
+			static Registry state;
+			return state;
+		}
+
+		static ThreadBuffer& threadBuffer() {
+			static thread_local ThreadBuffer* buffer = nullptr;
+			if (buffer == nullptr) {
+				Registry& reg = registry();
+				std::lock_guard<std::mutex> lock(reg.mutex);
+				buffer = new ThreadBuffer(reg.buffers.size());
+				reg.buffers.push_back(buffer);
+			}
+			return *buffer;
+		}
+
+	public:
+		static ui64 now() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().start).count();
+		}
+
+		static void record(const char* name, ui64 begin, ui64 end) {
+			ThreadBuffer& buffer = threadBuffer();
+			const ui64 index = buffer.written.load(std::memory_order_relaxed);
+			buffer.zones[index % ZONES_PER_THREAD] = { name, begin, end - begin };
+			buffer.written.store(index + 1, std::memory_order_release);
+		}
+
+		static void nameThread(const char* name) { threadBuffer().name = name; }
+
+		/*drops every recorded zone*/
+		static void reset() {
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			for (ThreadBuffer* buffer : reg.buffers) buffer->written.store(0, std::memory_order_release);
+		}
+
+		/*complete ("X") events in microseconds, one tid per recording thread, returns false when the file can't be written*/
+		static bool writeChromeTrace(const std::string& path) {
+			FILE* file = fopen(path.c_str(), "w");
+			if (file == NULL) return false;
+
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+
+			fprintf(file, "{\"traceEvents\":[\n");
+			bool first = true;
+			for (ThreadBuffer* buffer : reg.buffers) {
+				if (buffer->name != nullptr) {
+					fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",\n", buffer->id);
+					writeEscaped(file, buffer->name);
+					fprintf(file, "\"}}");
+					first = false;
+				}
+
+				const ui64 written = buffer->written.load(std::memory_order_acquire);
+				const ui64 begin = written > ZONES_PER_THREAD ? written - ZONES_PER_THREAD : 0;
+				for (ui64 i = begin; i < written; i++) {
+					const Zone& zone = buffer->zones[i % ZONES_PER_THREAD];
+
+					fprintf(file, "%s{\"name\":\"", first ? "" : ",\n");
+					writeEscaped(file, zone.name);
+					fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+						buffer->id, zone.begin / 1000.0, zone.duration / 1000.0);
+					first = false;
+				}
+			}
+			fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+			fclose(file);
+			return true;
+		}
+
+	private:
+		static void writeEscaped(FILE* file, const char* text) {
+			for (const char* c = text; *c; c++) {
+				if (*c == '"' || *c == '\\') fputc('\\', file);
+				fputc(*c, file);
+			}
+		}
+	};
+
+	/*records the time between its construction and destruction, use it through VOI_PROFILE_ZONE*/
+	class ProfileZone {
+		const char* name;
+		ui64 begin;
+
+	public:
+		ProfileZone(const char* _name) : name(_name), begin(Profiler::now()) {}
+		~ProfileZone() { Profiler::record(name, begin, Profiler::now()); }
+	};
+}
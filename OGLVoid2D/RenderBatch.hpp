@@ -3,14 +3,48 @@
 #include "Shader.h"
 
 class RenderBatch {
+	friend class SharedBatch;
+
 	GAO *gao;
 	Shader program;
+
+	// vertices and elements are staged here during the frame and reach the gpu in one upload each, right before the draw,
+	// both vectors are only cleared so their capacity is reused frame after frame
+	std::vector<ui8> vertexArena;
 	std::vector<ui32> elementVec;
 
+	size_t uploadedVertBytes = 0;
+	bool elementsDirty = false;
+
+	// while a batch holds nothing but quads it keeps no elements and draws from the gao's shared quad element buffer
+	bool quadOnly = true;
+	ui32 quadCount = 0;
+
+	// elements are uploaded as 16 bit, relative to the chunk they belong to, a new chunk starts whenever a
+	// primitive would reach past 64K vertices from the chunk's first one, each chunk is one draw with its own base vertex,
+	// a single primitive over 64K vertices makes the whole batch go back to 32 bit elements
+	struct ElementChunk {
+		ui32 firstElement;
+		ui32 baseVertex;
+	};
+	std::vector<ElementChunk> chunks;
+	std::vector<ui16> shortElements;
+	bool wideElements = false;
+
+	// an instanced batch holds one record per sprite instead of vertices, the shader expands each into a quad
+	bool instanced = false;
+
 	ui32 vaoIndex = 0;
-	ui32 elementCount = 0;
 
 	ui32 attribCount = 0;
+	ui32 vertexStride = 0;
+	std::vector<VertexAttrib> layout;
+
+	// while editing, reservations overwrite the vertices from "editCursor" on instead of appending,
+	// the gao tracks the rewritten ranges and only those are uploaded on the next draw
+	bool editing = false;
+	ui32 editCursor = 0;
+	std::vector<ui32> editElements;
 
 	std::vector<i32> textureIds	;
 
@@ -20,11 +54,45 @@ public:
 
 	RenderBatch(GAO* _gao, ui32 _vaoIndex, ui32 _programId) : gao(_gao), program(_programId), vaoIndex(_vaoIndex) {}
 
-	void defineVertBufferData(const std::vector<ui32>& attributes, GLenum usage = GL_DYNAMIC_DRAW, ui32 size = 1000, const std::vector<float>& vertData = {}) {
+	void defineVertBufferData(const std::vector<VertexAttrib>& attributes, GLenum usage = GL_DYNAMIC_DRAW, ui32 size = 1000, const std::vector<float>& vertData = {}) {
 		gao->defineVerBufferData(vaoIndex, attributes, usage, size, vertData);
-		attribCount = attributes.size();
+		setLayout(attributes);
+
+		vertexArena.assign((const ui8*)vertData.data(), (const ui8*)(vertData.data() + vertData.size()));
+		uploadedVertBytes = vertexArena.size();
+	}
+
+	/*vertices are written straight to a mapped ring of "frames" segments instead of one glBufferSubData per primitive*/
+	void defineVertStreamData(const std::vector<VertexAttrib>& attributes, ui32 size = 1000, ui32 frames = 3) {
+		gao->defineVerStreamData(vaoIndex, attributes, size, frames);
+		setLayout(attributes);
+
+		vertexArena.clear();
+		uploadedVertBytes = 0;
+	}
+
+	/*every "vertex" becomes one instance drawn as a 4 vertex triangle strip, the vertex shader builds the quad from gl_VertexID*/
+	void defineInstanceData(const std::vector<VertexAttrib>& attributes, bool stream = true, ui32 size = 1000, GLenum usage = GL_DYNAMIC_DRAW) {
+		if (stream) defineVertStreamData(attributes, size);
+		else defineVertBufferData(attributes, usage, size);
+
+		gao->setDivisor(vaoIndex, 1);
+		instanced = true;
+	}
+
+	bool isInstanced() { return instanced; }
+
+	/*gives this batch the layout, kind and textures of "other" on a plain (not streamed) buffer, its program is not copied*/
+	void defineLike(const RenderBatch& other, GLenum usage = GL_STATIC_DRAW, ui32 size = 64) {
+		if (other.instanced) defineInstanceData(other.layout, false, size, usage);
+		else defineVertBufferData(other.layout, usage, size);
+
+		textureIds = other.textureIds;
+		enableVAA();
 	}
 
+	ui32 programId() { return program.getId(); }
+
 	/*(VAA) VertexAttributeArray*/
 	void enableVAA(const std::vector<ui32>& attrs) {
 		gao->enable(vaoIndex, attrs);
@@ -40,29 +108,129 @@ public:
 	}
 
 
+	/*capacities only grow while drawing, this gives back what is above the current contents*/
+	void trimBatch() {
+		gao->trimVerBufferData(vaoIndex);
+		gao->trimElBufferData(vaoIndex);
+	}
+
+	const GAO::BOsInfo& vertBufferInfo() { return gao->getVerBufferInfo(vaoIndex); }
+	const GAO::BOsInfo& elBufferInfo() { return gao->getElBufferInfo(vaoIndex); }
+
 	void clearBatch() {
 		gao->clearVerBufferData(vaoIndex);
+		vertexArena.clear();
 		elementVec.clear();
 
-		elementCount = 0;
+		uploadedVertBytes = 0;
+		elementsDirty = true;
+
+		quadOnly = true;
+		quadCount = 0;
+
+		chunks.clear();
+		wideElements = false;
+
+		editing = false;
 	}
 
-	void addVertices(const std::vector<float>& vertData, const std::vector<ui32>& newElems) {
-		gao->addVerBufferData(vaoIndex, vertData);
+	ui32 vertexCount() { return vertexStride > 0 ? vertexArena.size() / vertexStride : 0; }
+	/*elements the batch draws, the implied ones of quad only batches included, none for instanced ones*/
+	ui32 elementCount() { return instanced ? 0 : (quadOnly ? quadCount * 6 : elementVec.size()); }
+
+	/*writable space for "vertCount" vertices and "elemCount" elements at the end of the batch, elements are
+	expected already offset by "base", the pointers are valid until the next reservation,
+	"first" and "count" is the range DrawRange takes to draw just this reservation*/
+	struct Reservation {
+		ui8* vertices;
+		ui32* elements;
+		ui32 base;
+		ui32 first;
+		ui32 count;
+	};
+
+	Reservation reserve(ui32 vertCount, ui32 elemCount) {
+		if (editing) return editReservation(vertCount, elemCount);
+		if (quadOnly) buildQuadElements();
+
+		const ui32 base = vertexCount();
+
+		if (chunks.empty() || base + vertCount - chunks.back().baseVertex > GAO::MAX_SHORT_VERTICES) {
+			chunks.push_back({ (ui32)elementVec.size(), base });
+		}
+		if (vertCount > GAO::MAX_SHORT_VERTICES) wideElements = true;
+
+		const size_t prevVertSize = vertexArena.size();
+		const size_t prevElemSize = elementVec.size();
+		vertexArena.resize(prevVertSize + vertCount * vertexStride);
+		elementVec.resize(prevElemSize + elemCount);
+		elementsDirty = true;
+
+		return { vertexArena.data() + prevVertSize, elementVec.data() + prevElemSize, base, (ui32)prevElemSize, elemCount };
+	}
+
+	/*room for "count" quads of four vertices each, drawn as 0,1,2 2,3,0, no elements have to be written*/
+	Reservation reserveQuads(ui32 count) {
+		if (editing) return editReservation(count * 4, 0);
+		if (!quadOnly) {
+			Reservation res = reserve(count * 4, count * 6);
+			for (ui32 q = 0; q < count; q++) {
+				const ui32 v = res.base + q * 4;
+				ui32* e = res.elements + q * 6;
+				e[0] = v; e[1] = v + 1; e[2] = v + 2;
+				e[3] = v + 2; e[4] = v + 3; e[5] = v;
+			}
+			return res;
+		}
+
+		const ui32 base = vertexCount();
+		const ui32 first = quadCount * 6;
+
+		const size_t prevVertSize = vertexArena.size();
+		vertexArena.resize(prevVertSize + count * 4 * vertexStride);
+		quadCount += count;
+
+		return { vertexArena.data() + prevVertSize, nullptr, base, first, count * 6 };
+	}
+
+	/*room for "count" instance records of an instanced batch*/
+	Reservation reserveInstances(ui32 count) {
+		if (editing) return editReservation(count, 0);
+
+		const ui32 base = vertexCount();
+
+		const size_t prevVertSize = vertexArena.size();
+		vertexArena.resize(prevVertSize + count * vertexStride);
+
+		return { vertexArena.data() + prevVertSize, nullptr, base, base, count };
+	}
+
+	/*following reservations rewrite the batch from "vertex" on, they must follow the same primitives in the
+	same order as when the vertices were first written since the elements are kept*/
+	void beginEdit(ui32 vertex) {
+		editing = true;
+		editCursor = vertex;
+	}
 
-		ui32 gt = 0;
-		for (auto elem : newElems) {
-			ui32 nElem = elementCount + elem;
+	void endEdit() { editing = false; }
 
-			gt = nElem > gt ? nElem : gt;
+	void addVertices(const float* vertData, ui32 vertCount, const ui32* newElems, ui32 elemCount) {
+		Reservation res = reserve(vertCount, elemCount);
 
-			elementVec.push_back(nElem);
+		memcpy(res.vertices, vertData, vertCount * vertexStride);
+		for (ui32 i = 0; i < elemCount; i++) {
+			res.elements[i] = res.base + newElems[i];
 		}
-		elementCount = gt + 1;
+	}
+
+	void addVertices(const std::vector<float>& vertData, const std::vector<ui32>& newElems) {
+		const ui32 vertCount = vertexStride > 0 ? (vertData.size() * sizeof(float)) / vertexStride : 0;
+		addVertices(vertData.data(), vertCount, newElems.data(), newElems.size());
 	}
 
 	i32 addTexture(ui32 id, i32 unit = -1) {
-		if (unit >= 0 && unit < textureIds.size()) {
+		if (unit >= 0 && unit < 32) {
+			if (unit >= (i32)textureIds.size()) textureIds.resize(unit + 1, 0);
 			textureIds[unit] = id;
 			return unit;
 		}
@@ -73,20 +241,340 @@ public:
 		return -1;
 	}
 
+	/*sends whatever was staged since the last upload, one vertex and one element transfer at most*/
+	void uploadBatch() {
+		VOI_PROFILE_ZONE("RenderBatch::uploadBatch");
+		gao->flushVerBufferData(vaoIndex, vertexArena.data());
+
+		if (vertexArena.size() > uploadedVertBytes) {
+			gao->addVerBufferData(vaoIndex, vertexArena.data() + uploadedVertBytes, vertexArena.size() - uploadedVertBytes);
+			uploadedVertBytes = vertexArena.size();
+		}
+		if (elementsDirty && !quadOnly && !instanced) {
+			if (wideElements) {
+				gao->setElBufferData(vaoIndex, elementVec, GL_DYNAMIC_DRAW);
+			}
+			else {
+				packShortElements();
+				gao->setElBufferData(vaoIndex, shortElements.data(), shortElements.size(), GL_DYNAMIC_DRAW);
+			}
+		}
+		elementsDirty = false;
+	}
+
+	ui32 drawElementCount() { return quadOnly ? quadCount * 6 : elementVec.size(); }
+
 	void DrawBatch(GLenum mode = GL_TRIANGLES, bool redraw = false) {
+		VOI_PROFILE_ZONE("RenderBatch::DrawBatch");
 		program.use();
-		if (!redraw) gao->setElBufferData(vaoIndex, elementVec, GL_DYNAMIC_DRAW);
-		else gao->bindVao(vaoIndex);
+		if (!redraw) uploadBatch();
+		if (!instanced) bindElements();
 
 		for (int i = 0; i < textureIds.size(); i++) {
-			glActiveTexture(GL_TEXTURE0 + i);
-			glBindTexture(GL_TEXTURE_2D, textureIds[i]);
+			GLState::bindTexture(i, textureIds[i]);
 		}
 
-		glDrawElements(mode, elementVec.size(), GL_UNSIGNED_INT, 0);
+		drawElements(mode);
 	}
 	void ReDrawBatch() {
-		gao->bindVao(vaoIndex);
-		glDrawElements(GL_TRIANGLES, elementVec.size(), GL_UNSIGNED_INT, 0);
+		if (!instanced) bindElements();
+		drawElements(GL_TRIANGLES);
+	}
+
+	/*draws "count" elements (instances when instanced) from "first" of what was already uploaded, a quad only
+	batch takes the elements its quads will have, 6 per quad*/
+	void DrawRange(ui32 first, ui32 count, GLenum mode = GL_TRIANGLES) {
+		VOI_PROFILE_ZONE("RenderBatch::DrawRange");
+		program.use();
+		if (!instanced) bindElements();
+
+		for (int i = 0; i < textureIds.size(); i++) {
+			GLState::bindTexture(i, textureIds[i]);
+		}
+
+		const i32 baseVertex = gao->prepareVerDraw(vaoIndex);
+
+		if (instanced) {
+			gao->offsetAttributes(vaoIndex, baseVertex + first);
+			gao->bindVao(vaoIndex);
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+			FrameStats::drawCall();
+		}
+		else if (quadOnly) {
+			const ui32 firstQuad = first / 6;
+			const ui32 quads = count / 6;
+			for (ui32 q = 0; q < quads; q += GAO::QUADS_PER_ELEMENT_BUFFER) {
+				const ui32 n = quads - q < GAO::QUADS_PER_ELEMENT_BUFFER ? quads - q : GAO::QUADS_PER_ELEMENT_BUFFER;
+				glDrawElementsBaseVertex(mode, n * 6, GL_UNSIGNED_SHORT, 0, baseVertex + (firstQuad + q) * 4);
+				FrameStats::drawCall();
+			}
+		}
+		else if (wideElements) {
+			glDrawElementsBaseVertex(mode, count, GL_UNSIGNED_INT, (void*)(first * sizeof(ui32)), baseVertex);
+			FrameStats::drawCall();
+		}
+		else {
+			/*a range can cover several chunks, each part draws with the base vertex of its chunk*/
+			const ui32 end = first + count;
+			for (size_t c = 0; c < chunks.size(); c++) {
+				const ui32 begin = chunks[c].firstElement > first ? chunks[c].firstElement : first;
+				const ui32 stop = chunkEnd(c) < end ? chunkEnd(c) : end;
+				if (begin >= stop) continue;
+
+				glDrawElementsBaseVertex(mode, stop - begin, GL_UNSIGNED_SHORT, (void*)(begin * sizeof(ui16)), baseVertex + chunks[c].baseVertex);
+				FrameStats::drawCall();
+			}
+		}
+	}
+
+private:
+	Reservation editReservation(ui32 vertCount, ui32 elemCount) {
+		const ui32 available = vertexCount() > editCursor ? vertexCount() - editCursor : 0;
+		if (vertCount > available) throw "Outside of range Exception";
+
+		const size_t begin = (size_t)editCursor * vertexStride;
+		gao->markVerBufferDirty(vaoIndex, begin, (size_t)vertCount * vertexStride);
+
+		/*the elements written by the caller repeat the existing ones, they go to a scratch vector*/
+		editElements.resize(elemCount);
+
+		const ui32 base = editCursor;
+		editCursor += vertCount;
+		return { vertexArena.data() + begin, editElements.data(), base, 0, 0 };
+	}
+
+	void bindElements() {
+		if (quadOnly) gao->useQuadElements(vaoIndex);
+		else gao->useOwnElements(vaoIndex);
+	}
+
+	ui32 chunkEnd(size_t c) { return c + 1 < chunks.size() ? chunks[c + 1].firstElement : elementVec.size(); }
+
+	/*elements as 16 bit, relative to the base vertex of their chunk*/
+	void packShortElements() {
+		shortElements.resize(elementVec.size());
+		for (size_t c = 0; c < chunks.size(); c++) {
+			const ui32 end = chunkEnd(c);
+			const ui32 chunkBase = chunks[c].baseVertex;
+			for (ui32 e = chunks[c].firstElement; e < end; e++) {
+				shortElements[e] = (ui16)(elementVec[e] - chunkBase);
+			}
+		}
+	}
+
+	void drawElements(GLenum mode) {
+		const i32 baseVertex = gao->prepareVerDraw(vaoIndex);
+
+		if (instanced) {
+			gao->offsetAttributes(vaoIndex, baseVertex);
+			gao->bindVao(vaoIndex);
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, vertexCount());
+			FrameStats::drawCall();
+		}
+		else if (quadOnly) {
+			for (ui32 q = 0; q < quadCount; q += GAO::QUADS_PER_ELEMENT_BUFFER) {
+				const ui32 count = quadCount - q < GAO::QUADS_PER_ELEMENT_BUFFER ? quadCount - q : GAO::QUADS_PER_ELEMENT_BUFFER;
+				glDrawElementsBaseVertex(mode, count * 6, GL_UNSIGNED_SHORT, 0, baseVertex + q * 4);
+				FrameStats::drawCall();
+			}
+		}
+		else if (wideElements) {
+			glDrawElementsBaseVertex(mode, elementVec.size(), GL_UNSIGNED_INT, 0, baseVertex);
+			FrameStats::drawCall();
+		}
+		else {
+			for (size_t c = 0; c < chunks.size(); c++) {
+				const ui32 first = chunks[c].firstElement;
+				glDrawElementsBaseVertex(mode, chunkEnd(c) - first, GL_UNSIGNED_SHORT, (void*)(first * sizeof(ui16)), baseVertex + chunks[c].baseVertex);
+				FrameStats::drawCall();
+			}
+		}
+
+		gao->fenceVerDraw(vaoIndex);
+	}
+
+	/*leaves quad only mode, the quads staged so far get their elements written out*/
+	void buildQuadElements() {
+		quadOnly = false;
+
+		elementVec.resize(quadCount * 6);
+		for (ui32 q = 0; q < quadCount; q++) {
+			if (q % GAO::QUADS_PER_ELEMENT_BUFFER == 0) chunks.push_back({ q * 6, q * 4 });
+
+			const ui32 v = q * 4;
+			ui32* e = elementVec.data() + q * 6;
+			e[0] = v; e[1] = v + 1; e[2] = v + 2;
+			e[3] = v + 2; e[4] = v + 3; e[5] = v;
+		}
+		quadCount = 0;
+		elementsDirty = true;
+	}
+
+	void setLayout(const std::vector<VertexAttrib>& attributes) {
+		attribCount = attributes.size();
+		layout = attributes;
+
+		vertexStride = VertexAttrib::stride(attributes);
+	}
+};
+
+/*draws several batches of the same program and vertex layout from one shared buffer, the members only stage
+their geometry, each frame it is gathered here in one vertex and one element upload and issued with
+glMultiDrawElementsBaseVertex, one call per run of members bound to the same textures*/
+class SharedBatch {
+	GAO *gao;
+	Shader program;
+	ui32 vaoIndex;
+
+	std::vector<ui16> elements;
+	ui32 patternQuads = 0;
+
+	// one entry per draw, members add theirs in order, a run is a range of entries sharing the textures of "member"
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets;
+	std::vector<GLint> baseVertices;
+	// baseVertices moved to the segment the draw reads from, rebuilt every draw so the gathered ones can be drawn again
+	std::vector<GLint> drawBaseVertices;
+
+	struct DrawRun {
+		ui32 first;
+		ui32 count;
+		const std::vector<i32>* textures;
+	};
+	std::vector<DrawRun> runs;
+	// a member with 32 bit elements or another vertex layout (the atlas page batches), those draw by themselves
+	bool anyAlone = false;
+	std::vector<VertexAttrib> layout;
+
+public:
+	SharedBatch(GAO* _gao, ui32 _vaoIndex, ui32 _programId) : gao(_gao), program(_programId), vaoIndex(_vaoIndex) {}
+
+	/*takes the layout of "member", batches of any other layout are drawn by themselves*/
+	void defineLike(const RenderBatch& member, bool stream = true, ui32 size = 1000) {
+		if (stream) gao->defineVerStreamData(vaoIndex, member.layout, size);
+		else gao->defineVerBufferData(vaoIndex, member.layout, GL_DYNAMIC_DRAW, size);
+		layout = member.layout;
+
+		std::vector<ui32> attrs(member.attribCount);
+		for (ui32 i = 0; i < member.attribCount; i++) {
+			attrs[i] = i;
+		}
+		gao->enable(vaoIndex, attrs);
+	}
+
+	void DrawBatches(RenderBatch* members, ui32 count, GLenum mode = GL_TRIANGLES) {
+		UploadBatches(members, count);
+		DrawUploaded(members, count, mode);
+	}
+
+	/*gathers the members' vertices and elements into the shared buffers*/
+	void UploadBatches(RenderBatch* members, ui32 count) {
+		VOI_PROFILE_ZONE("SharedBatch::UploadBatches");
+		gao->clearVerBufferData(vaoIndex);
+		counts.clear(); offsets.clear(); baseVertices.clear();
+		runs.clear();
+
+		/*quad only members all draw from the same 0,1,2 2,3,0 pattern at the start of the elements*/
+		ui32 maxQuads = 0;
+		for (ui32 m = 0; m < count; m++) {
+			if (members[m].quadOnly && members[m].quadCount > maxQuads) maxQuads = members[m].quadCount;
+		}
+		buildPattern(maxQuads < GAO::QUADS_PER_ELEMENT_BUFFER ? maxQuads : GAO::QUADS_PER_ELEMENT_BUFFER);
+
+		anyAlone = false;
+		for (ui32 m = 0; m < count; m++) {
+			RenderBatch& member = members[m];
+			if (member.vertexCount() == 0) continue;
+			/*a primitive over 64K vertices needs 32 bit elements and another layout can't share the buffer, that member draws by itself*/
+			if (alone(member)) {
+				anyAlone = true;
+				continue;
+			}
+
+			const ui32 base = gao->getVerBufferInfo(vaoIndex).size / member.vertexStride;
+			gao->addVerBufferData(vaoIndex, member.vertexArena.data(), member.vertexArena.size());
+
+			const ui32 first = counts.size();
+			if (member.quadOnly) {
+				for (ui32 q = 0; q < member.quadCount; q += GAO::QUADS_PER_ELEMENT_BUFFER) {
+					const ui32 quads = member.quadCount - q < GAO::QUADS_PER_ELEMENT_BUFFER ? member.quadCount - q : GAO::QUADS_PER_ELEMENT_BUFFER;
+					addDraw(quads * 6, 0, base + q * 4);
+				}
+			}
+			else {
+				member.packShortElements();
+				const size_t elemOffset = elements.size();
+				elements.insert(elements.end(), member.shortElements.begin(), member.shortElements.end());
+
+				for (size_t c = 0; c < member.chunks.size(); c++) {
+					const ui32 firstElement = member.chunks[c].firstElement;
+					addDraw(member.chunkEnd(c) - firstElement, elemOffset + firstElement, base + member.chunks[c].baseVertex);
+				}
+			}
+
+			if (!runs.empty() && *runs.back().textures == member.textureIds) runs.back().count += counts.size() - first;
+			else runs.push_back({ first, (ui32)(counts.size() - first), &member.textureIds });
+		}
+
+		if (!runs.empty()) {
+			gao->setElBufferData(vaoIndex, elements.data(), elements.size(), GL_DYNAMIC_DRAW);
+		}
+		if (anyAlone) {
+			for (ui32 m = 0; m < count; m++) {
+				if (alone(members[m]) && members[m].vertexCount() > 0) members[m].uploadBatch();
+			}
+		}
+	}
+
+	/*draws what the last UploadBatches of the same "members" gathered*/
+	void DrawUploaded(RenderBatch* members, ui32 count, GLenum mode = GL_TRIANGLES) {
+		VOI_PROFILE_ZONE("SharedBatch::DrawUploaded");
+		if (!runs.empty()) {
+			program.use();
+			gao->useOwnElements(vaoIndex);
+
+			const i32 segmentBase = gao->prepareVerDraw(vaoIndex);
+			drawBaseVertices.resize(baseVertices.size());
+			for (size_t i = 0; i < baseVertices.size(); i++) drawBaseVertices[i] = baseVertices[i] + segmentBase;
+
+			gao->bindVao(vaoIndex);
+			for (const DrawRun& run : runs) {
+				for (size_t i = 0; i < run.textures->size(); i++) {
+					GLState::bindTexture(i, (*run.textures)[i]);
+				}
+
+				glMultiDrawElementsBaseVertex(mode, counts.data() + run.first, GL_UNSIGNED_SHORT,
+					offsets.data() + run.first, run.count, drawBaseVertices.data() + run.first);
+				FrameStats::drawCall();
+			}
+			gao->fenceVerDraw(vaoIndex);
+		}
+
+		if (anyAlone) {
+			for (ui32 m = 0; m < count; m++) {
+				if (alone(members[m]) && members[m].vertexCount() > 0) members[m].DrawBatch(mode, true);
+			}
+		}
+	}
+
+private:
+	bool alone(const RenderBatch& member) { return member.wideElements || member.vertexStride != VertexAttrib::stride(layout); }
+
+	void addDraw(ui32 elemCount, size_t firstElement, ui32 baseVertex) {
+		counts.push_back(elemCount);
+		offsets.push_back((const void*)(firstElement * sizeof(ui16)));
+		baseVertices.push_back(baseVertex);
+	}
+
+	/*drops last frame's member elements, the pattern only grows so it's written once*/
+	void buildPattern(ui32 quads) {
+		elements.resize(patternQuads * 6);
+
+		for (ui32 q = patternQuads; q < quads; q++) {
+			const ui16 v = q * 4;
+			const ui16 quad[6] = { v, (ui16)(v + 1), (ui16)(v + 2), (ui16)(v + 2), (ui16)(v + 3), v };
+			elements.insert(elements.end(), quad, quad + 6);
+		}
+		if (quads > patternQuads) patternQuads = quads;
 	}
-};
\ No newline at end of file
+};
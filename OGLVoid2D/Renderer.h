@@ -5,13 +5,23 @@
 #include <iostream>
 #include <chrono>
 #include <vector>
+#include <array>
 #include <string>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 
 #include "utilDefs.h"
 #include "Pixel.h"
+#include "GLState.h"
 #include "GAO.h"
 #include "Shader.h"
 #include "RenderBatch.hpp"
+#include "Atlas.h"
+#include "DrawQueue.h"
+#include "FrameQueue.h"
+#include "FrameTimer.h"
+#include "Headless.h"
 
 namespace voi {
 	struct BatchGroup {
@@ -34,6 +44,13 @@ namespace voi {
 		Pixel color;
 
 		FillVertex2D(Vec2f _pos, Pixel _color): pos(_pos), color(_color) {}
+
+		static bool anyTranslucent(const FillVertex2D* vertData, ui32 vertCount) {
+			for (ui32 i = 0; i < vertCount; i++) {
+				if (vertData[i].color.a < 1.f) return true;
+			}
+			return false;
+		}
 	};
 
 	struct TexVertex2D {
@@ -44,6 +61,134 @@ namespace voi {
 		TexVertex2D(Vec2f _pos, Pixel _color, Vec2f _texCoord) : pos(_pos), color(_color), texCoord(_texCoord) {}
 	};
 
+	// batch vertex formats, positions stay full floats (sprites are often partly off screen, normalized shorts would clamp them),
+	// colors are normalized RGBA8. texture coordinates are floats, they repeat and need texel precision far past 1,
+	// except in the batches of atlas pages, where they always fall in [0,1] and are normalized 16 bit
+	struct FillFormat {
+		static std::vector<VertexAttrib> layout() { return { 3, { 4, GL_UNSIGNED_BYTE, true } }; }
+		static const ui32 stride = 16;
+	};
+	struct TexFormat {
+		static std::vector<VertexAttrib> layout(bool atlas) { return { 3, { 4, GL_UNSIGNED_BYTE, true }, texCoord(2, atlas) }; }
+		static ui32 stride(bool atlas) { return atlas ? 20 : 24; }
+
+		static VertexAttrib texCoord(ui32 count, bool atlas) { return atlas ? VertexAttrib(count, GL_UNSIGNED_SHORT, true) : VertexAttrib(count); }
+	};
+	/*sprite records: rect (x, y, w, h), z, color, and for textured ones the texture rect*/
+	struct FillSpriteFormat {
+		static std::vector<VertexAttrib> layout() { return { 4, 1, { 4, GL_UNSIGNED_BYTE, true } }; }
+		static const ui32 stride = 24;
+	};
+	struct TexSpriteFormat {
+		static std::vector<VertexAttrib> layout(bool atlas) { return { 4, 1, { 4, GL_UNSIGNED_BYTE, true }, TexFormat::texCoord(4, atlas) }; }
+		static ui32 stride(bool atlas) { return atlas ? 32 : 40; }
+	};
+	/*the texture slot batches add the unit the texture is bound to, read as an uint by the shader*/
+	struct SlotTexFormat {
+		static std::vector<VertexAttrib> layout(bool atlas) { return { 3, { 4, GL_UNSIGNED_BYTE, true }, TexFormat::texCoord(2, atlas), { 1, GL_UNSIGNED_BYTE, false, true } }; }
+		static ui32 stride(bool atlas) { return TexFormat::stride(atlas) + 4; }
+	};
+	struct SlotTexSpriteFormat {
+		static std::vector<VertexAttrib> layout(bool atlas) { return { 4, 1, { 4, GL_UNSIGNED_BYTE, true }, TexFormat::texCoord(4, atlas), { 1, GL_UNSIGNED_BYTE, false, true } }; }
+		static ui32 stride(bool atlas) { return TexSpriteFormat::stride(atlas) + 4; }
+	};
+
+	/*write access to vertices reserved in a batch, vertex and element indices are local to the reservation*/
+	struct FillShapeView {
+		ui8* vertices;
+		ui32* elements;
+		ui32 base;
+
+		void vertex(ui32 i, const Vec2f& pos, float z, const Pixel& color) {
+			ui8* v = vertices + i * FillFormat::stride;
+			const float p[3] = { pos.x, pos.y, z };
+			const ui32 c = color.packRGBA8();
+
+			memcpy(v, p, sizeof(p));
+			memcpy(v + 12, &c, sizeof(c));
+		}
+		void element(ui32 i, ui32 vert) { elements[i] = base + vert; }
+		/*two triangles 0,1,2 2,3,0 over the four vertices starting at "vert"*/
+		void quad(ui32 i, ui32 vert) {
+			element(i, vert); element(i + 1, vert + 1); element(i + 2, vert + 2);
+			element(i + 3, vert + 2); element(i + 4, vert + 3); element(i + 5, vert);
+		}
+	};
+
+	/*writes TexFormat vertices, or SlotTexFormat ones with "slot" after the texture coordinate when it isn't negative,
+	"atlas" picks the format of the atlas page batches*/
+	struct TexShapeView {
+		ui8* vertices;
+		ui32* elements;
+		ui32 base;
+		i32 slot = -1;
+		bool atlas = false;
+
+		void vertex(ui32 i, const Vec2f& pos, float z, const Pixel& color, const Vec2f& texCoord) {
+			ui8* v = vertices + i * (slot < 0 ? TexFormat::stride(atlas) : SlotTexFormat::stride(atlas));
+			const float p[3] = { pos.x, pos.y, z };
+			const ui32 c = color.packRGBA8();
+
+			memcpy(v, p, sizeof(p));
+			memcpy(v + 12, &c, sizeof(c));
+			if (atlas) {
+				const ui16 t[2] = { floatToUnorm16(texCoord.x), floatToUnorm16(texCoord.y) };
+				memcpy(v + 16, t, sizeof(t));
+			}
+			else {
+				const float t[2] = { texCoord.x, texCoord.y };
+				memcpy(v + 16, t, sizeof(t));
+			}
+			if (slot >= 0) v[TexFormat::stride(atlas)] = (ui8)slot;
+		}
+		void element(ui32 i, ui32 vert) { elements[i] = base + vert; }
+		void quad(ui32 i, ui32 vert) {
+			element(i, vert); element(i + 1, vert + 1); element(i + 2, vert + 2);
+			element(i + 3, vert + 2); element(i + 4, vert + 3); element(i + 5, vert);
+		}
+	};
+
+	/*write access to instance records of the sprite batches, one record is a whole rect*/
+	struct FillSpriteView {
+		ui8* records;
+		ui32 base;
+
+		void sprite(ui32 i, float x, float y, float w, float h, float z, const Pixel& color) {
+			ui8* r = records + i * FillSpriteFormat::stride;
+			const float rect[5] = { x, y, w, h, z };
+			const ui32 c = color.packRGBA8();
+
+			memcpy(r, rect, sizeof(rect));
+			memcpy(r + 20, &c, sizeof(c));
+		}
+	};
+
+	struct TexSpriteView {
+		ui8* records;
+		ui32 base;
+		i32 slot = -1;
+		bool atlas = false;
+
+		/*"texMin" is the texture coordinate at (x, y), "texMax" the one at (x + w, y + h)*/
+		void sprite(ui32 i, float x, float y, float w, float h, float z, const Pixel& color, const Vec2f& texMin, const Vec2f& texMax) {
+			ui8* r = records + i * (slot < 0 ? TexSpriteFormat::stride(atlas) : SlotTexSpriteFormat::stride(atlas));
+			const float rect[5] = { x, y, w, h, z };
+			const ui32 c = color.packRGBA8();
+
+			memcpy(r, rect, sizeof(rect));
+			memcpy(r + 20, &c, sizeof(c));
+			if (atlas) {
+				const ui16 t[4] = { floatToUnorm16(texMin.x), floatToUnorm16(texMin.y), floatToUnorm16(texMax.x), floatToUnorm16(texMax.y) };
+				memcpy(r + 24, t, sizeof(t));
+			}
+			else {
+				const float t[4] = { texMin.x, texMin.y, texMax.x, texMax.y };
+				memcpy(r + 24, t, sizeof(t));
+			}
+			if (slot >= 0) r[TexSpriteFormat::stride(atlas)] = (ui8)slot;
+		}
+	};
+
 	struct Surface {
 		Pixel* data;
 		int width, height;
@@ -56,159 +201,721 @@ namespace voi {
 		Texture(const Surface &other): data((ui8*)other.data), width(other.width), height(other.height), nChannels(4) {}
 	};
 
+	/*a translucent primitive waiting for the sorted pass, "batch" indexes the translucent batches it was written to*/
+	struct TranslucentDraw {
+		float z;
+		ui32 program;
+		ui32 batch;
+		ui32 first;
+		ui32 count;
+	};
+
+	/*retained geometry, one batch per engine batch on its own static buffers, it's drawn every frame
+	before the dynamic batches and only Invalidate or an edit touches it.
+	with the translucent pass its translucent primitives get batches of their own (the vaos after the opaque ones)
+	and are sorted every frame together with the frame's*/
+	struct StaticLayer {
+		GAO *gao;
+		std::vector<RenderBatch> batches;
+		std::vector<RenderBatch> translucentBatches;
+		std::vector<TranslucentDraw> translucentDraws;
+		bool visible = true;
+
+		StaticLayer(ui32 count) : gao(new GAO(count)) {}
+		~StaticLayer() { delete gao; }
+	};
+
+	/*where a recorded primitive starts, used to rewrite it later with EditStaticLayer*/
+	struct StaticMark {
+		ui32 layer;
+		ui32 batch;
+		ui32 vertex;
+		// the batch is one of the layer's translucent ones
+		bool translucent = false;
+	};
+
+	/*draw calls recorded on a worker thread, a buffer belongs to one thread at a time so recording takes no locks,
+	commands and their vertices go to the buffer's own arenas and the engine replays the buffers on the render thread
+	in index order (SubmitCommandBuffers), so the frame doesn't depend on which thread finished first*/
+	class CommandBuffer {
+		friend class VoiOGLEngine;
+		friend class SoftRasterizer;
+
+		enum Kind : ui8 { FILL_SHAPE, TEXTURE_SHAPE, FILL_QUAD, TEXTURE_QUAD, FILL_RECT, TEXTURE_RECT };
+
+		// quads and rects keep their 4 corners in the arena, rects rebuild x, y, w, h from corners 0 and 2
+		struct Command {
+			Kind kind;
+			ui32 texture;
+			Pixel color;
+			float z;
+			ui32 vertFirst, vertCount;
+			ui32 elemFirst, elemCount;
+		};
+
+		std::vector<Command> commands;
+		std::vector<FillVertex2D> fillVertices;
+		std::vector<TexVertex2D> texVertices;
+		std::vector<ui32> elements;
+		ui32 texture = 0;
+
+	public:
+		Pixel drawColor = { 1.0f,1.0f,1.0f,1.0f };
+
+		/*texture handle (as given by AddTexture) of the next textured commands*/
+		void ChooseCurrentTextures(ui32 handle) { texture = handle; }
+
+		void FillTriangle(Vec2f p1, Vec2f p2, Vec2f p3, float z = 0) {
+			const ui32 elems[] = { 0, 1, 2 };
+			fillVertices.emplace_back(p1, drawColor); fillVertices.back().pos.z = z;
+			fillVertices.emplace_back(p2, drawColor); fillVertices.back().pos.z = z;
+			fillVertices.emplace_back(p3, drawColor); fillVertices.back().pos.z = z;
+			push(FILL_SHAPE, z, fillVertices.size() - 3, 3, elems, 3);
+		}
+
+		void FillQuad(Vec2f p1, Vec2f p2, Vec2f p3, Vec2f p4, float z = 0) {
+			for (const Vec2f* p : { &p1, &p2, &p3, &p4 }) {
+				fillVertices.emplace_back(*p, drawColor);
+				fillVertices.back().pos.z = z;
+			}
+			push(FILL_QUAD, z, fillVertices.size() - 4, 4, nullptr, 0);
+		}
+
+		void FillRect(float x, float y, float w, float h, float z = 0) {
+			FillQuad({ x, y }, { x + w, y }, { x + w, y + h }, { x, y + h }, z);
+			commands.back().kind = FILL_RECT;
+		}
+
+		void TextureTri(Vec2f p1, Vec2f p2, Vec2f p3, float z = 0,
+			Vec2f t1 = { 0.0,0.0 }, Vec2f t2 = { 1.0,0.0 }, Vec2f t3 = { 0.0,1.0 }) {
+			const ui32 elems[] = { 0, 1, 2 };
+			texVertices.emplace_back(p1, drawColor, t1); texVertices.back().pos.z = z;
+			texVertices.emplace_back(p2, drawColor, t2); texVertices.back().pos.z = z;
+			texVertices.emplace_back(p3, drawColor, t3); texVertices.back().pos.z = z;
+			push(TEXTURE_SHAPE, z, texVertices.size() - 3, 3, elems, 3);
+		}
+
+		void TextureQuad(Vec2f p1, Vec2f p2, Vec2f p3, Vec2f p4, float z = 0,
+			Vec2f t1 = { 0.0,0.0 }, Vec2f t2 = { 1.0,0.0 }, Vec2f t3 = { 1.0,1.0 }, Vec2f t4 = { 0.0,1.0 }) {
+			texVertices.emplace_back(p1, drawColor, t1); texVertices.back().pos.z = z;
+			texVertices.emplace_back(p2, drawColor, t2); texVertices.back().pos.z = z;
+			texVertices.emplace_back(p3, drawColor, t3); texVertices.back().pos.z = z;
+			texVertices.emplace_back(p4, drawColor, t4); texVertices.back().pos.z = z;
+			push(TEXTURE_QUAD, z, texVertices.size() - 4, 4, nullptr, 0);
+		}
+
+		void TextureRect(float x, float y, float w, float h, float z = 0,
+			Vec2f t1 = { 0.0,0.0 }, Vec2f t2 = { 1.0,0.0 }, Vec2f t3 = { 1.0,1.0 }, Vec2f t4 = { 0.0,1.0 }) {
+			TextureQuad({ x, y }, { x + w, y }, { x + w, y + h }, { x, y + h }, z, t1, t2, t3, t4);
+			commands.back().kind = TEXTURE_RECT;
+		}
+
+		void FillShape(const FillVertex2D* vertData, ui32 vertCount, const ui32* elems, ui32 elemCount) {
+			for (ui32 i = 0; i < vertCount; i++) fillVertices.push_back(vertData[i]);
+			push(FILL_SHAPE, vertCount > 0 ? vertData[0].pos.z : 0, fillVertices.size() - vertCount, vertCount, elems, elemCount);
+		}
+
+		void TextureShape(const TexVertex2D* vertData, ui32 vertCount, const ui32* elems, ui32 elemCount) {
+			for (ui32 i = 0; i < vertCount; i++) texVertices.push_back(vertData[i]);
+			push(TEXTURE_SHAPE, vertCount > 0 ? vertData[0].pos.z : 0, texVertices.size() - vertCount, vertCount, elems, elemCount);
+		}
+
+		ui32 commandCount() { return commands.size(); }
+
+		/*adds the commands of "other" after these ones*/
+		void append(const CommandBuffer& other) {
+			const ui32 fillBase = fillVertices.size(), texBase = texVertices.size(), elemBase = elements.size();
+			const bool textured[] = { false, true, false, true, false, true };
+
+			for (Command command : other.commands) {
+				command.vertFirst += textured[command.kind] ? texBase : fillBase;
+				command.elemFirst += elemBase;
+				commands.push_back(command);
+			}
+			for (const FillVertex2D& vertex : other.fillVertices) fillVertices.push_back(vertex);
+			for (const TexVertex2D& vertex : other.texVertices) texVertices.push_back(vertex);
+			elements.insert(elements.end(), other.elements.begin(), other.elements.end());
+		}
+
+		/*drops the commands, the arenas keep their memory for the next frame*/
+		void reset() {
+			commands.clear();
+			fillVertices.clear();
+			texVertices.clear();
+			elements.clear();
+		}
+
+	private:
+		void push(Kind kind, float z, ui32 vertFirst, ui32 vertCount, const ui32* elems, ui32 elemCount) {
+			commands.push_back({ kind, texture, drawColor, z, vertFirst, vertCount, (ui32)elements.size(), elemCount });
+			if (elemCount > 0) elements.insert(elements.end(), elems, elems + elemCount);
+		}
+	};
+
+
+	/*what Update hands to the render thread, the frame's draw calls and the state they're drawn with*/
+	struct FramePacket {
+		CommandBuffer commands;
+		Pixel clearColor;
+		// Clear() was called, the batches start empty instead of adding to the last frame
+		bool clear = false;
+		// seconds Update and Render took
+		double updateTime = 0;
+	};
+
+	/*options of VoiOGLEngine::Construct*/
+	struct EngineConfig {
+		// vertices go through mapped ring buffers instead of glBufferSubData
+		bool streamVertices = true;
+		// FillRect and axis aligned TextureRect become instanced sprites
+		bool instanceSprites = true;
+		// non instanced groups are drawn with one glMultiDrawElementsBaseVertex submission each
+		bool multiDrawGroups = true;
+		// textured draws go to batches binding TEXTURE_SLOTS textures at once, raises the texture limit to MAX_TEXTURES
+		bool textureSlots = true;
+		// AddTexture packs images up to TextureAtlas::MAX_REGION_SIZE into shared atlas pages
+		bool atlasTextures = true;
+		// translucent primitives are blended in a pass of their own, sorted back to front
+		bool sortTranslucent = true;
+		// Update gets this constant delta (seconds), called as many times as the elapsed time asks for, 0 passes the frame time instead
+		double fixedStep = 0;
+		// steps a frame may run before the time left is dropped, so a slow frame doesn't make the next ones slower
+		ui32 maxStepsPerFrame = 5;
+		// times the frame phases on the cpu and with gpu timestamp queries, see GetFrameTiming
+		bool frameTiming = false;
+		// the gl context moves to a render thread after Begin, Update records frame packets that thread draws while
+		// the next frame is simulated. Update may only draw, choose textures and set colors, the rest of the api is for Begin
+		bool renderThread = false;
+		// no window, the frames are drawn into an offscreen framebuffer of the Construct size, see HeadlessContext
+		bool headless = false;
+		// the loop ends after this many frames, 0 runs until the window closes or Stop is called
+		ui64 maxFrames = 0;
+	};
 
 	class VoiOGLEngine {
-		GLFWwindow* window;
+		GLFWwindow* window = NULL;
+		// owns the context when headless, declared first so it outlives the gl objects of the other members
+		HeadlessContext headless;
+		ui32 frameWidth = 0;
+		ui32 frameHeight = 0;
+		ui64 maxFrames = 0;
+		std::atomic<bool> stopRequested{ false };
 		Pixel clearColor = { 0.f,0.f,0.f,0.f };
 
 		GAO *mainGao;
 		std::vector<RenderBatch> batches;
 
-		float totalTime;
-		float loopStartT;
-		float loopEndT;
+		// seconds since glfwInit (context creation when headless), doubles so hours of uptime don't eat the frame deltas
+		double totalTime = 0;
+		double loopStartT = 0;
+		double loopEndT = 0;
+
+		// with a fixed step Update always advances the simulation by fixedStep, "accumulator" is the time
+		// not simulated yet and "interpolation" how far (0 to 1) the frame is between the last two steps
+		double fixedStep = 0;
+		ui32 maxStepsPerFrame = 5;
+		double accumulator = 0;
+		float interpolation = 1.f;
 
 		ui64 frameCount = 0;
 
 		ui32 shapeVertexCount = 0;
 
-		ui32 textures[32];
+		// texture "t" is batch "t" of the single texture groups (the first 32) and unit t % TEXTURE_SLOTS of
+		// batch t / TEXTURE_SLOTS of the slot groups
+		static const ui32 TEXTURE_SLOTS = 16;
+		static const ui32 MAX_TEXTURES = 128;
+		ui32 textures[MAX_TEXTURES];
 		ui32 unasignedTexBatch = 0;
 
+		// handles from ATLAS_HANDLE_BASE on are atlas regions, the texture coordinates of textured draws are
+		// mapped into the current region through texRect (offset x, y and scale x, y)
+		static const ui32 ATLAS_HANDLE_BASE = MAX_TEXTURES;
+		TextureAtlas atlas;
+		bool atlasTextures = true;
+		float texRect[4] = { 0.f, 0.f, 1.f, 1.f };
+
+		// textures and regions with some alpha under 255 make the primitives drawn with them translucent
+		bool textureAlpha[MAX_TEXTURES] = {};
+		bool currentAlpha = false;
+
 		//---batches configuration---//
 		
 		// index dictates in wich place de batch group starts, count how many consecutive batches of said group there are
 		// to get the real position of a batch group, add the count of all previous batch groups
 		BatchGroup solidGroup = { 0, 1, 0, 0 };
 		BatchGroup singleTexGroup = { 1, 32, 1, 0 };
+		// instanced rects, batch "i" of the texture sprites shares the texture of singleTexGroup batch "i"
+		BatchGroup solidSpriteGroup = { 2, 1, 33, 0 };
+		BatchGroup texSpriteGroup = { 3, 32, 34, 0 };
+		// each batch binds TEXTURE_SLOTS textures and every vertex / record says which one it samples,
+		// so textured draws mixing those textures stay in one batch, singleTexGroup.current picks the texture
+		BatchGroup slotTexGroup = { 4, MAX_TEXTURES / TEXTURE_SLOTS, 66, 0 };
+		BatchGroup slotSpriteGroup = { 5, MAX_TEXTURES / TEXTURE_SLOTS, 74, 0 };
+
+		bool spriteInstancing = true;
+		bool textureSlots = true;
+
+		// with multi draw the non instanced groups are drawn through one shared buffer each,
+		// sharedBatches[i] draws the batches of sharedGroups[i]
+		bool multiDraw = true;
+		std::vector<SharedBatch> sharedBatches;
+		std::vector<BatchGroup> sharedGroups;
+
+		//---static layers---//
+
+		std::vector<StaticLayer*> layers;
+
+		//---translucent pass---//
+
+		// opaque primitives stay in the batches, the depth test sorts them out and keeps them merged in as few draws as possible,
+		// translucent ones (solid with some alpha under 1 or textured with alpha) are staged in a layer of their own
+		// and drawn after everything else with blending, one command per primitive sorted back to front.
+		// the static layers' translucent primitives are sorted in the same pass
+		bool sortTranslucent = true;
+		StaticLayer *translucent = nullptr;
+		std::vector<TranslucentDraw> translucentDraws;
+		DrawQueue translucentQueue;
+		// layer the reservations go to instead of the engine batches, null when drawing dynamic geometry
+		StaticLayer *recording = nullptr;
+		StaticMark lastMark = { 0, 0, 0 };
+		// batch of the recording layer EditStaticLayer rewrites, -1 when not editing
+		i32 editingBatch = -1;
+		bool editingTranslucent = false;
+
+		//---worker recording---//
+
+		std::vector<CommandBuffer*> commandBuffers;
+
+		//---render thread---//
+
+		// Update fills "packet" (null on the render thread and without renderThread) while the render thread draws the
+		// previous packets, FRAMES_IN_FLIGHT bounds how far the simulation runs ahead
+		static const ui32 FRAMES_IN_FLIGHT = 2;
+		bool renderThread = false;
+		FrameQueue<FramePacket> frames{ FRAMES_IN_FLIGHT };
+		FramePacket *packet = nullptr;
+		// handle last given to ChooseCurrentTextures, recorded with the textured commands
+		ui32 recordTexture = 0;
+
+		//---profiling---//
+
+		// used by the thread drawing, Update times are added to it with the frame they belong to
+		FrameTimer timer;
+		// one line of FrameCounters per frame when open
+		FILE *countersCsv = NULL;
 
 	public:
 		~VoiOGLEngine() {
+			for (StaticLayer* layer : layers) delete layer;
+			for (CommandBuffer* buffer : commandBuffers) delete buffer;
+			if (countersCsv != NULL) fclose(countersCsv);
+			if (translucent != nullptr) delete translucent;
 			if (mainGao != nullptr) delete mainGao;
 		}
 
 		void Start() {
 			First();
-			/*cleans resources alocated by glfw*/
-			glfwTerminate();
+			/*cleans resources alocated by glfw, the headless context goes with the engine*/
+			if (!headless.isCreated()) glfwTerminate();
 		}
-		bool Construct(const char* title, ui32 width, ui32 height) {
-			glfwInit();
-			/*hints at the version of openGL to use (3.3)*/
-			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-			/*hints that we want to use the core mode in openGL*/
-			glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-			/*creates the window*/
-			window = glfwCreateWindow(width, height, title, NULL, NULL);
+		bool Construct(const char* title, ui32 width, ui32 height, bool streamVertices = true, bool instanceSprites = true, bool multiDrawGroups = true) {
+			EngineConfig config;
+			config.streamVertices = streamVertices;
+			config.instanceSprites = instanceSprites;
+			config.multiDrawGroups = multiDrawGroups;
 
-			if (window == NULL) {
-				std::cout << "Failed to create GLFW window" << std::endl;
-				glfwTerminate();
-				return false;
+			return Construct(title, width, height, config);
+		}
+		bool Construct(const char* title, ui32 width, ui32 height, const EngineConfig& config) {
+			const bool streamVertices = config.streamVertices;
+			GLADloadproc loader = (GLADloadproc)glfwGetProcAddress;
+
+			frameWidth = width;
+			frameHeight = height;
+			maxFrames = config.maxFrames;
+
+			if (config.headless) {
+				if (!headless.create(width, height)) {
+					std::cout << "Failed to create headless context" << std::endl;
+					headless.destroy();
+					return false;
+				}
+				loader = headless.loader();
 			}
+			else {
+				glfwInit();
+				/*hints at the version of openGL to use (3.3)*/
+				glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+				glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+				/*hints that we want to use the core mode in openGL*/
+				glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+				/*creates the window*/
+				window = glfwCreateWindow(width, height, title, NULL, NULL);
+
+				if (window == NULL) {
+					std::cout << "Failed to create GLFW window" << std::endl;
+					glfwTerminate();
+					return false;
+				}
 
-			/*makes the created window the current context in wich glfw works*/
-			glfwMakeContextCurrent(window);
-			glfwSetWindowAttrib(window, GLFW_RESIZABLE, GLFW_FALSE);
+				/*makes the created window the current context in wich glfw works*/
+				glfwMakeContextCurrent(window);
+				/*the binding cache is process wide, what it remembers belongs to whatever context was current before*/
+				GLState::invalidate();
+				glfwSetWindowAttrib(window, GLFW_RESIZABLE, GLFW_FALSE);
+			}
 
 			/*GLAD initialization*/
-			if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+			if (!gladLoadGLLoader(loader)) {
 				std::cout << "Failed to initialize GLAD" << std::endl;
 				return false;
 			}
 
+			GAO::loadBufferStorage(loader);
+
+			if (config.headless && !headless.createFramebuffer()) {
+				std::cout << "Failed to create headless framebuffer" << std::endl;
+				return false;
+			}
 
 			/*sets opengl viewport size*/
 			glViewport(0, 0, width, height);
 
 			/*sets function to callback when window is rezised*/
-			glfwSetFramebufferSizeCallback(window, viewportResize);
+			if (window != NULL) glfwSetFramebufferSizeCallback(window, viewportResize);
 
 			//glfwSwapInterval(0);
 
-			glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-			glEnable(GL_DEPTH_TEST);
-			glDepthFunc(GL_LEQUAL);
+			SetClearColor({ 0.2f, 0.3f, 0.3f, 1.0f });
+			GLState::setDepthTest(true);
+			GLState::setDepthFunc(GL_LEQUAL);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-			mainGao = new GAO(
+			const ui32 batchCount =
 				solidGroup.count +
-				singleTexGroup.count
-			);
-			glGenTextures(
-				singleTexGroup.count
-				, textures);
+				singleTexGroup.count +
+				solidSpriteGroup.count +
+				texSpriteGroup.count +
+				slotTexGroup.count +
+				slotSpriteGroup.count;
 
-			batches.emplace_back(mainGao, solidGroup.position, "default.vert", "default.frag"); //solidBatch
-			batches[solidGroup.position].defineVertBufferData({ 3,4 });
+			multiDraw = config.multiDrawGroups;
 
-			std::ifstream vertexFile("texture.vert"), fragmentFile("texture.frag");
-			std::stringstream vertexStream, fragmentStream;
+			GLint textureUnits = 0;
+			glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+			textureSlots = config.textureSlots && textureUnits >= (GLint)TEXTURE_SLOTS;
 
-			vertexStream << vertexFile.rdbuf();
-			fragmentStream << fragmentFile.rdbuf();
+			/*the shared batches take the slots after the batch groups*/
+			mainGao = new GAO(batchCount + (multiDraw ? 3 : 0));
+			glGenTextures(MAX_TEXTURES, textures);
 
-			std::string vertexCode = vertexStream.str(), fragmentCode = fragmentStream.str();
+			batches.emplace_back(mainGao, solidGroup.position, "default.vert", "default.frag"); //solidBatch
+			if (streamVertices) batches[solidGroup.position].defineVertStreamData(FillFormat::layout());
+			else batches[solidGroup.position].defineVertBufferData(FillFormat::layout());
 
-			vertexFile.close(); fragmentFile.close();
+			atlasTextures = config.atlasTextures;
 
-			const ui32 singleTexProgram = Shader::programLinking(vertexCode, fragmentCode);
+			const ui32 singleTexProgram = Shader::programLoading("texture.vert", "texture.frag");
 
 			for (int i = singleTexGroup.position; i < (singleTexGroup.position + singleTexGroup.count); i++) {
 				batches.emplace_back(mainGao, i, singleTexProgram); //singleTexBatches
-				batches[i].defineVertBufferData({ 3,4,2 });
+				const bool atlasPage = IsAtlasPage(i - singleTexGroup.position);
+				if (streamVertices) batches[i].defineVertStreamData(TexFormat::layout(atlasPage));
+				else batches[i].defineVertBufferData(TexFormat::layout(atlasPage));
 			}
+
+			spriteInstancing = config.instanceSprites;
+			sortTranslucent = config.sortTranslucent;
+			renderThread = config.renderThread;
+			fixedStep = config.fixedStep;
+			if (config.frameTiming) timer.enable(true);
+			maxStepsPerFrame = config.maxStepsPerFrame > 0 ? config.maxStepsPerFrame : 1;
+
+			batches.emplace_back(mainGao, solidSpriteGroup.position, "sprite.vert", "default.frag"); //solidSpriteBatch
+			batches[solidSpriteGroup.position].defineInstanceData(FillSpriteFormat::layout(), streamVertices);
+
+			const ui32 texSpriteProgram = Shader::programLoading("sprite.vert", "texture.frag");
+
+			for (int i = texSpriteGroup.position; i < (texSpriteGroup.position + texSpriteGroup.count); i++) {
+				batches.emplace_back(mainGao, i, texSpriteProgram); //texSpriteBatches
+				batches[i].defineInstanceData(TexSpriteFormat::layout(IsAtlasPage(i - texSpriteGroup.position)), streamVertices);
+			}
+
+			/*every slot samples the unit of the same index*/
+			const ui32 slotTexProgram = Shader::programLoading("slottex.vert", "slottex.frag");
+			const ui32 slotSpriteProgram = Shader::programLoading("slotsprite.vert", "slottex.frag");
+			for (ui32 program : { slotTexProgram, slotSpriteProgram }) {
+				Shader shader(program);
+				shader.use();
+				for (ui32 unit = 0; unit < TEXTURE_SLOTS; unit++) {
+					shader.setInt("tex[" + std::to_string(unit) + "]", unit);
+				}
+			}
+
+			for (int i = slotTexGroup.position; i < (slotTexGroup.position + slotTexGroup.count); i++) {
+				batches.emplace_back(mainGao, i, slotTexProgram); //slotTexBatches
+				const bool atlasPage = IsAtlasPage((i - slotTexGroup.position) * TEXTURE_SLOTS);
+				if (streamVertices) batches[i].defineVertStreamData(SlotTexFormat::layout(atlasPage));
+				else batches[i].defineVertBufferData(SlotTexFormat::layout(atlasPage));
+			}
+			for (int i = slotSpriteGroup.position; i < (slotSpriteGroup.position + slotSpriteGroup.count); i++) {
+				batches.emplace_back(mainGao, i, slotSpriteProgram); //slotSpriteBatches
+				batches[i].defineInstanceData(SlotTexSpriteFormat::layout(IsAtlasPage((i - slotSpriteGroup.position) * TEXTURE_SLOTS)), streamVertices);
+			}
+
+			if (multiDraw) {
+				for (const BatchGroup& group : { solidGroup, singleTexGroup, slotTexGroup }) {
+					const RenderBatch& first = batches[group.position];
+
+					sharedBatches.emplace_back(mainGao, batchCount + sharedGroups.size(), batches[group.position].programId());
+					sharedBatches.back().defineLike(first, streamVertices);
+					sharedGroups.push_back(group);
+				}
+			}
+
+			if (sortTranslucent) {
+				translucent = new StaticLayer(batches.size());
+				for (ui32 i = 0; i < batches.size(); i++) {
+					translucent->batches.emplace_back(translucent->gao, i, batches[i].programId());
+					translucent->batches[i].defineLike(batches[i], GL_DYNAMIC_DRAW, 1000);
+				}
+			}
+
+			return true;
 		}
 
 
 	protected:
 		virtual void Begin() = 0;
 		virtual void Update(float deltaTime) = 0;
+		/*called once per frame after the Update steps, "alpha" is GetInterpolation(), draw here what should be
+		interpolated between the last two fixed steps*/
+		virtual void Render(float alpha) {}
 		virtual void Finish() = 0;
 
+		/*starts the frame over, dropping what was drawn and what the command buffers hold, so the workers must not be
+		recording while it runs. with fixedStep only the last step of the frame is drawn*/
 		void Clear() {
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			for (CommandBuffer* buffer : commandBuffers) buffer->reset();
+			if (packet != nullptr) {
+				packet->commands.reset();
+				packet->clear = true;
+				return;
+			}
+			ClearBatches();
+		}
 
+		/*batch buffers grow to fit the biggest frame seen and stay there, call after a heavy scene is gone*/
+		void TrimBuffers() {
 			for (auto &batch : batches) {
-				batch.clearBatch();
+				batch.trimBatch();
+			}
+		}
+
+		/*creates an empty static layer and returns its index, layers are drawn in creation order*/
+		ui32 CreateStaticLayer() {
+			const ui32 count = batches.size();
+			StaticLayer *layer = new StaticLayer(translucent != nullptr ? count * 2 : count);
+
+			for (ui32 i = 0; i < count; i++) {
+				layer->batches.emplace_back(layer->gao, i, batches[i].programId());
+				layer->batches[i].defineLike(batches[i]);
 			}
+			if (translucent != nullptr) {
+				for (ui32 i = 0; i < count; i++) {
+					layer->translucentBatches.emplace_back(layer->gao, count + i, batches[i].programId());
+					layer->translucentBatches[i].defineLike(batches[i]);
+				}
+			}
+
+			layers.push_back(layer);
+			return layers.size() - 1;
+		}
+
+		/*drops what the layer holds and sends every draw call to it until EndStaticLayer, Clear() doesn't affect it*/
+		bool BeginStaticLayer(ui32 layer) {
+			if (layer >= layers.size() || recording != nullptr) return false;
+
+			InvalidateStaticLayer(layer);
+
+			recording = layers[layer];
+			return true;
+		}
+
+		/*stops recording or editing, draw calls go back to the per frame batches*/
+		void EndStaticLayer() {
+			if (recording == nullptr) return;
+
+			for (auto &batch : recording->batches) batch.endEdit();
+			for (auto &batch : recording->translucentBatches) batch.endEdit();
+			recording = nullptr;
+			editingBatch = -1;
+		}
+
+		/*empties the layer, it stays created so it can be recorded again*/
+		void InvalidateStaticLayer(ui32 layer) {
+			if (layer >= layers.size()) return;
+
+			for (auto &batch : layers[layer]->batches) batch.clearBatch();
+			for (auto &batch : layers[layer]->translucentBatches) batch.clearBatch();
+			layers[layer]->translucentDraws.clear();
+		}
+
+		void SetStaticLayerVisible(ui32 layer, bool visible) {
+			if (layer < layers.size()) layers[layer]->visible = visible;
+		}
+
+		/*mark of the last primitive recorded into a static layer*/
+		StaticMark LastStaticMark() { return lastMark; }
+
+		/*the following draw calls overwrite the layer's geometry from "mark" on, they must be the same kind of
+		primitives drawn with the same batch (texture) as when recorded, only the rewritten bytes are uploaded, finish with EndStaticLayer.
+		a draw going to another batch or past the end of the marked one throws. translucent primitives keep the depth they
+		were sorted with when recorded*/
+		bool EditStaticLayer(const StaticMark &mark) {
+			if (mark.layer >= layers.size() || recording != nullptr) return false;
+
+			std::vector<RenderBatch>& target = mark.translucent ? layers[mark.layer]->translucentBatches : layers[mark.layer]->batches;
+			if (mark.batch >= target.size() || mark.vertex > target[mark.batch].vertexCount()) throw "Outside of range Exception";
+
+			recording = layers[mark.layer];
+			target[mark.batch].beginEdit(mark.vertex);
+			editingBatch = mark.batch;
+			editingTranslucent = mark.translucent;
+			return true;
 		}
 
 		Pixel GetClearColor() { return clearColor; }
+		/*returns the index of a new command buffer, create them before handing them to the worker threads*/
+		ui32 CreateCommandBuffer() {
+			commandBuffers.push_back(new CommandBuffer());
+			return commandBuffers.size() - 1;
+		}
+
+		CommandBuffer& GetCommandBuffer(ui32 buffer) {
+			if (buffer >= commandBuffers.size()) throw "Outside of range Exception";
+			return *commandBuffers[buffer];
+		}
+
+		/*replays every command buffer in index order into the current batches (or the recording layer) and resets them,
+		called after Update for the buffers left, the workers must be done with them by then.
+		with a render thread they are added to the frame packet instead*/
+		void SubmitCommandBuffers() {
+			VOI_PROFILE_ZONE("SubmitCommandBuffers");
+			if (packet != nullptr) {
+				for (CommandBuffer* buffer : commandBuffers) {
+					packet->commands.append(*buffer);
+					buffer->reset();
+				}
+				return;
+			}
+
+			for (CommandBuffer* buffer : commandBuffers) {
+				Replay(*buffer);
+				buffer->reset();
+			}
+			SelectTexture(recordTexture);
+		}
+
 		void SetClearColor(const Pixel &p) {
 			clearColor = p;
-			glClearColor(p.r, p.g, p.b, p.a);
+			if (packet == nullptr) glClearColor(p.r, p.g, p.b, p.a);
 		}
 
-		float GetTotalTime() { return totalTime; }
+		double GetTotalTime() { return totalTime; }
+		/*gl work of the last drawn frame*/
+		FrameCounters GetFrameCounters() { return FrameStats::last(); }
+
+		/*writes the counters of every frame drawn from now on to the csv file at "path", call it from Begin or Finish
+		when using the render thread. returns false when the file can't be opened*/
+		bool StreamCountersCsv(const std::string& path) {
+			StopCountersCsv();
+			countersCsv = fopen(path.c_str(), "w");
+			if (countersCsv == NULL) return false;
+
+			const char* names[] = { "solid", "texture", "solidSprite", "textureSprite", "slotTexture", "slotSprite" };
+			fprintf(countersCsv, "frame,drawCalls,programSwitches,textureBinds,vaoBinds,vertexBytes,elementBytes,textureBytes");
+			for (const BatchGroup* group : Groups()) fprintf(countersCsv, ",%sVertices,%sElements", names[group->index], names[group->index]);
+			fprintf(countersCsv, ",programBreaks,textureBreaks,capacityBreaks\n");
+			return true;
+		}
+
+		void StopCountersCsv() {
+			if (countersCsv != NULL) fclose(countersCsv);
+			countersCsv = NULL;
+		}
+
+		/*cpu and gpu milliseconds of each FramePhase over the last frames, all 0 without EngineConfig::frameTiming*/
+		FrameTiming GetFrameTiming() { return timer.timing(); }
+
+		/*how far the frame is between the last two fixed steps (0 to 1), always 1 without fixedStep*/
+		float GetInterpolation() { return interpolation; }
 
 		ui64 GetFrameCount() { return frameCount; }
 
+		/*null when headless*/
 		GLFWwindow* GetWindow() { return window; }
 
+		/*ends the loop once the current frame is done, Finish runs after it*/
+		void Stop() { stopRequested = true; }
+
+		/*copies the framebuffer into "rgba", 4 bytes per pixel and rows from the top. meant for headless runs, where it
+		holds the last presented frame until the next Clear(), so call it from Update before clearing or from Finish.
+		needs the context, so not from Update with the render thread*/
+		void ReadPixels(std::vector<ui8>& rgba) {
+			const ui32 row = frameWidth * 4;
+			rgba.resize(row * frameHeight);
+
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+			glReadPixels(0, 0, frameWidth, frameHeight, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+			/*gl gives the bottom row first*/
+			for (ui32 y = 0; y < frameHeight / 2; y++) {
+				std::swap_ranges(rgba.begin() + y * row, rgba.begin() + (y + 1) * row, rgba.begin() + (frameHeight - 1 - y) * row);
+			}
+		}
+
+		ui32 GetFrameWidth() { return frameWidth; }
+		ui32 GetFrameHeight() { return frameHeight; }
+
 		Pixel drawColor = { 1.0f,1.0f,1.0f,1.0f };
 
 		bool ChooseCurrentTextures(ui32 batch, ui32 unit = 0) {
-			if (batch >= 0 && batch < singleTexGroup.count) {
-				singleTexGroup.current = batch;
+			if (packet != nullptr) {
+				/*the render thread owns the texture state, the handle just goes with the commands*/
+				if (!(batch < TextureLimit() || (batch >= ATLAS_HANDLE_BASE && batch - ATLAS_HANDLE_BASE < atlas.regionCount()))) return false;
+				recordTexture = batch;
 				return true;
 			}
-			return false;
+
+			if (!SelectTexture(batch)) return false;
+			recordTexture = batch;
+			return true;
 		}
 
+		/*returns the handle to pass to ChooseCurrentTextures, small GL_RGBA / GL_RGB images get an atlas region
+		instead of a texture of their own (they don't repeat, coordinates are clamped to the image)*/
 		ui32 AddTexture(int width, int height, const ui8 *data, bool mipmap = true, GLenum pixType = GL_RGBA, i32 batch = -1) {
+			VOI_PROFILE_ZONE("VoiOGLEngine::AddTexture");
+			if (data && batch < 0 && atlasTextures && TextureAtlas::fits(width, height) && (pixType == GL_RGBA || pixType == GL_RGB)) {
+				return AddAtlasTexture(width, height, data, pixType == GL_RGBA ? 4 : 3);
+			}
+
 			if (data) {
 				i32 batchIndex = batch;
 				if (batchIndex < 0) {
-					if (unasignedTexBatch >= 32)
+					if (unasignedTexBatch >= OwnTextureLimit())
 						return -1;
 					batchIndex = unasignedTexBatch;
 					unasignedTexBatch++;
 				}
+				else if (batchIndex >= (i32)OwnTextureLimit()) {
+					return -1;
+				}
 
-				glBindTexture(GL_TEXTURE_2D, textures[batchIndex]);
+				GLState::bindTexture(0, textures[batchIndex]);
 
 
 				// set the texture wrapping/filtering options (on the currently bound texture object)
@@ -218,11 +925,18 @@ namespace voi {
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, pixType, GL_UNSIGNED_BYTE, data);
+				FrameStats::textureUpload((ui64)width * height * (pixType == GL_RGBA ? 4 : 3));
 				if (mipmap) {
 					glGenerateMipmap(GL_TEXTURE_2D);
 				}
+				textureAlpha[batchIndex] = data && pixType == GL_RGBA && TextureAtlas::hasAlpha(width, height, data, 4);
 
-				batches[batchIndex + singleTexGroup.position].addTexture(textures[batchIndex]);
+				AssignTexture(batches, batchIndex);
+				if (translucent != nullptr) AssignTexture(translucent->batches, batchIndex);
+				for (StaticLayer* layer : layers) {
+					AssignTexture(layer->batches, batchIndex);
+					AssignTexture(layer->translucentBatches, batchIndex);
+				}
 
 				return batchIndex;
 			}
@@ -231,9 +945,15 @@ namespace voi {
 		}
 
 		ui32 ChangeTexture(ui32 batch, int width, int height, const ui8* data, bool mipmap = true, GLenum pixType = GL_RGBA) {
-			if (data && batch < singleTexGroup.count) {
+			VOI_PROFILE_ZONE("VoiOGLEngine::ChangeTexture");
+			/*an atlas region keeps its place, so only an image of the same size can replace it*/
+			if (data && batch >= ATLAS_HANDLE_BASE && (pixType == GL_RGBA || pixType == GL_RGB)) {
+				return atlas.update(batch - ATLAS_HANDLE_BASE, width, height, data, pixType == GL_RGBA ? 4 : 3) ? batch : -1;
+			}
+
+			if (data && batch < OwnTextureLimit()) {
 
-				glBindTexture(GL_TEXTURE_2D, textures[batch]);
+				GLState::bindTexture(0, textures[batch]);
 
 				// set the texture wrapping/filtering options (on the currently bound texture object)
 				//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -242,9 +962,11 @@ namespace voi {
 				//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, pixType, GL_UNSIGNED_BYTE, data);
+				FrameStats::textureUpload((ui64)width * height * (pixType == GL_RGBA ? 4 : 3));
 				if (mipmap) {
 					glGenerateMipmap(GL_TEXTURE_2D);
 				}
+				textureAlpha[batch] = data && pixType == GL_RGBA && TextureAtlas::hasAlpha(width, height, data, 4);
 
 				//batches[batch + singleTexGroup.position].addTexture(textures[batch]);
 
@@ -254,94 +976,102 @@ namespace voi {
 			return -1;
 		}
 
+		/*texture coordinate of the current texture or atlas region, the raw Reserve views take mapped coordinates*/
+		Vec2f MapTexCoord(const Vec2f& t) { return { texRect[0] + t.x * texRect[2], texRect[1] + t.y * texRect[3] }; }
+
+		/*reserves room in the current solid batch, write exactly "vertCount" vertices and "elemCount" elements before the next draw call,
+		"z" only orders translucent primitives, the vertices keep their own. the Reserve views write into the batches,
+		with the render thread they throw when called from Update*/
+		FillShapeView ReserveFillShape(ui32 vertCount, ui32 elemCount, float z = 0) {
+			RequireBatches();
+			return ReserveSolidShape(vertCount, elemCount, z, drawColor.a < 1.f);
+		}
+
+		/*same as ReserveFillShape for the current texture batch*/
+		TexShapeView ReserveTextureShape(ui32 vertCount, ui32 elemCount, float z = 0) {
+			RequireBatches();
+			return ReserveTexShape(vertCount, elemCount, z);
+		}
+
+		/*reserves "count" quads (4 vertices each, local vertex 4 * q is the first of quad q), their elements
+		are implied so the view's elements must not be written*/
+		FillShapeView ReserveFillQuads(ui32 count, float z = 0) {
+			RequireBatches();
+			return ReserveSolidQuads(count, z, drawColor.a < 1.f);
+		}
+
+		TexShapeView ReserveTextureQuads(ui32 count, float z = 0) {
+			RequireBatches();
+			return ReserveTexQuads(count, z);
+		}
+
+		/*reserves "count" instanced rects in the solid sprite batch*/
+		FillSpriteView ReserveFillSprites(ui32 count, float z = 0) {
+			RequireBatches();
+			return ReserveSolidSprites(count, z, drawColor.a < 1.f);
+		}
+
+		/*reserves "count" instanced rects in the sprite batch of the current texture*/
+		TexSpriteView ReserveTextureSprites(ui32 count, float z = 0) {
+			RequireBatches();
+			return ReserveTexSprites(count, z);
+		}
+
 		void FillTriangle(float x1, float y1, float x2, float y2, float x3, float y3, float z = 0) {
 			FillTriangle({ x1,y1 }, { x2,y2 }, { x3,y3 }, z);
 		}
 		void FillTriangle(Vec2f p1, Vec2f p2, Vec2f p3, float z = 0) {
-			batches[solidGroup.current + solidGroup.position].addVertices({
-				p1.x, p1.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a,
-				p2.x, p2.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a,
-				p3.x, p3.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a
-				}, { 0,1,2 }
-			);
+			if (packet != nullptr) { Recorder().FillTriangle(p1, p2, p3, z); return; }
+			PutFillTriangle(p1, p2, p3, z, drawColor);
 		}
 
 		void FillQuad(float x1, float y1, float x2, float y2, float x3, float y3, float z = 0) {
 			FillTriangle({ x1,y1 }, { x2,y2 }, { x3,y3 });
 		}
 		void FillQuad(Vec2f p1, Vec2f p2, Vec2f p3, Vec2f p4, float z = 0) {
-
-			batches[solidGroup.current + solidGroup.position].addVertices({
-				p1.x, p1.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a,
-				p2.x, p2.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a,
-				p3.x, p3.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a,
-				p4.x, p4.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a
-			}, { 0, 1, 2, 2, 3, 0 });
+			if (packet != nullptr) { Recorder().FillQuad(p1, p2, p3, p4, z); return; }
+			PutFillQuad(p1, p2, p3, p4, z, drawColor);
 		}
 
 		void FillRect(float x, float y, float w, float h, float z = 0) {
-			FillQuad(
-				{     x, y     },
-				{ x + w, y     },
-				{ x + w, y + h },
-				{     x, y + h },
-				z
-			);
+			if (packet != nullptr) { Recorder().FillRect(x, y, w, h, z); return; }
+			PutFillRect(x, y, w, h, z, drawColor);
 		}
 
 		void TextureTri(Vec2f p1, Vec2f p2, Vec2f p3, float z = 0,
 			Vec2f t1 = { 0.0,0.0 }, Vec2f t2 = { 1.0,0.0 }, Vec2f t3 = { 0.0,1.0 }) { 
-
-			batches[singleTexGroup.current + singleTexGroup.position].addVertices({
-				p1.x, p1.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a, t1.x, t1.y,
-				p2.x, p2.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a, t2.x, t2.y,
-				p3.x, p3.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a, t3.x, t3.y
-				}, { 0, 1, 2 });
+			if (packet != nullptr) { Recorder().TextureTri(p1, p2, p3, z, t1, t2, t3); return; }
+			PutTextureTri(p1, p2, p3, z, t1, t2, t3, drawColor);
 		}
 
 		void TextureQuad(Vec2f p1, Vec2f p2, Vec2f p3, Vec2f p4, float z = 0,
 			Vec2f t1 = { 0.0,0.0 }, Vec2f t2 = { 1.0,0.0 }, Vec2f t3 = { 1.0,1.0 }, Vec2f t4 = { 0.0,1.0 }) {
-
-			batches[singleTexGroup.current + singleTexGroup.position].addVertices({
-				p1.x, p1.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a, t1.x, t1.y,
-				p2.x, p2.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a, t2.x, t2.y,
-				p3.x, p3.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a, t3.x, t3.y,
-				p4.x, p4.y, z, drawColor.r, drawColor.g, drawColor.b, drawColor.a, t4.x, t4.y
-				}, { 0, 1, 2, 2, 3, 0 });
+			if (packet != nullptr) { Recorder().TextureQuad(p1, p2, p3, p4, z, t1, t2, t3, t4); return; }
+			PutTextureQuad(p1, p2, p3, p4, z, t1, t2, t3, t4, drawColor);
 		}
 
 		void TextureRect(float x, float y, float w, float h, float z = 0,
 			Vec2f t1 = { 0.0,0.0 }, Vec2f t2 = { 1.0,0.0 }, Vec2f t3 = { 1.0,1.0 }, Vec2f t4 = { 0.0,1.0 }) {
-			TextureQuad(
-				{ x, y },
-				{ x + w, y },
-				{ x + w, y + h },
-				{ x, y + h },
-				z, 
-				t1, t2, t3, t4
-			);
+			if (packet != nullptr) { Recorder().TextureRect(x, y, w, h, z, t1, t2, t3, t4); return; }
+			PutTextureRect(x, y, w, h, z, t1, t2, t3, t4, drawColor);
 		}
 
 
 
+		void FillShape(const FillVertex2D* vertData, ui32 vertCount, const ui32* elements, ui32 elemCount) {
+			if (packet != nullptr) { Recorder().FillShape(vertData, vertCount, elements, elemCount); return; }
+			PutFillShape(vertData, vertCount, elements, elemCount);
+		}
 		void FillShape(const std::vector<FillVertex2D> &vertData, const std::vector<ui32> &elements) {
-
-			const std::vector<float> floatData(
-				(float*)vertData.data(),
-				(float*)vertData.data() + (vertData.size() * ( sizeof(FillVertex2D)/sizeof(float) ))
-			);
-
-			batches[solidGroup.current + solidGroup.position].addVertices(floatData, elements);
+			FillShape(vertData.data(), vertData.size(), elements.data(), elements.size());
 		}
 
+		void TextureShape(const TexVertex2D* vertData, ui32 vertCount, const ui32* elements, ui32 elemCount) {
+			if (packet != nullptr) { Recorder().TextureShape(vertData, vertCount, elements, elemCount); return; }
+			PutTextureShape(vertData, vertCount, elements, elemCount);
+		}
 		void TextureShape(const std::vector<TexVertex2D>& vertData, const std::vector<ui32>& elements) {
-
-			const std::vector<float> floatData(
-				(float*)vertData.data(),
-				(float*)vertData.data() + (vertData.size() * (sizeof(TexVertex2D) / sizeof(float)))
-			);
-
-			batches[singleTexGroup.current + singleTexGroup.position].addVertices(floatData, elements);
+			TextureShape(vertData.data(), vertData.size(), elements.data(), elements.size());
 		}
 
 		
@@ -349,53 +1079,649 @@ namespace voi {
 	private:
 
 		void First() {
-			loopStartT = glfwGetTime();
+			loopStartT = Now();
 			loopEndT = loopStartT;
 
 
 			this->Begin();
+			SubmitCommandBuffers();
 
 
 			for (auto& batch : batches) { batch.enableVAA(); }
 
 			glClear(GL_COLOR_BUFFER_BIT);
 
-			for(auto &batch: batches) { batch.DrawBatch(); }
-			glfwSwapBuffers(window);
+			DrawFrame();
+			Present();
 
 			glClear(GL_COLOR_BUFFER_BIT);
 
-			for (auto &batch : batches) { batch.DrawBatch(); }
-			glfwSwapBuffers(window);
+			DrawFrame();
+			Present();
 
 			frameCount++;
 
 			this->Loop();
 		}
 		void Loop() {
-			float elapsed = 0;
-			while (!glfwWindowShouldClose(window)) {
-				loopEndT = glfwGetTime();
-				totalTime = loopEndT;
+			if (renderThread) {
+				ThreadedLoop();
+				return;
+			}
+
+			VOI_PROFILE_THREAD("main");
+			while (Running()) {
+				VOI_PROFILE_ZONE("Frame");
+				Simulate();
+				SubmitCommandBuffers();
+
+				DrawFrame();
+
+				Present();
+
+				frameCount++;
+
+				PollEvents();
+			}
+			this->Finish();
+		}
+
+		/*runs Update with the time since the last frame, or in fixedStep steps, then Render*/
+		void Simulate() {
+			VOI_PROFILE_ZONE("Update");
+			loopEndT = Now();
+			totalTime = loopEndT;
+
+			const double elapsed = loopEndT - loopStartT;
+			loopStartT = loopEndT;
+
+			const auto start = std::chrono::high_resolution_clock::now();
+
+			if (fixedStep <= 0) {
+				this->Update((float)elapsed);
+				interpolation = 1.f;
+			}
+			else {
+				accumulator += elapsed;
+				ui32 steps = 0;
+				while (accumulator >= fixedStep && steps < maxStepsPerFrame) {
+					this->Update((float)fixedStep);
+					accumulator -= fixedStep;
+					steps++;
+				}
+				/*behind by more than maxStepsPerFrame steps, the simulation slows down instead of catching up*/
+				if (accumulator >= fixedStep) accumulator = fmod(accumulator, fixedStep);
+
+				interpolation = (float)(accumulator / fixedStep);
+			}
+			this->Render(interpolation);
+
+			const double updateTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			if (packet != nullptr) packet->updateTime = updateTime;
+			else timer.add(PHASE_UPDATE, updateTime);
+		}
+
+		void Present() {
+			VOI_PROFILE_ZONE("Present");
+			timer.begin(PHASE_PRESENT);
+			if (window != NULL) glfwSwapBuffers(window);
+			else headless.present();
+			timer.end(PHASE_PRESENT);
+
+			timer.endFrame();
+
+			FrameStats::endFrame();
+			if (countersCsv != NULL) WriteCountersCsv(FrameStats::last());
+		}
 
-				elapsed = loopEndT - loopStartT;
-				loopStartT = loopEndT;
+		double Now() { return window != NULL ? glfwGetTime() : headless.time(); }
+
+		bool Running() {
+			if (stopRequested || (maxFrames > 0 && frameCount >= maxFrames)) return false;
+			return window == NULL || !glfwWindowShouldClose(window);
+		}
+
+		void PollEvents() {
+			if (window != NULL) glfwPollEvents();
+		}
+
+		/*binds the context to the calling thread, or releases it*/
+		void MakeCurrent(bool current) {
+			if (window == NULL) {
+				headless.makeCurrent(current);
+				return;
+			}
+			glfwMakeContextCurrent(current ? window : NULL);
+			if (current) GLState::invalidate();
+		}
 
-				this->Update(elapsed);
+		/*the batch groups in the order of their index*/
+		std::array<const BatchGroup*, 6> Groups() {
+			return { &solidGroup, &singleTexGroup, &solidSpriteGroup, &texSpriteGroup, &slotTexGroup, &slotSpriteGroup };
+		}
 
-				for (auto &batch : batches) {
-					batch.DrawBatch();
+		/*adds what each group of "target" is about to draw to the frame's counters*/
+		void CountGroups(std::vector<RenderBatch>& target) {
+			FrameCounters& counters = FrameStats::current();
+			for (const BatchGroup* group : Groups()) {
+				for (ui32 i = group->position; i < group->position + group->count && i < target.size(); i++) {
+					counters.groupVertices[group->index] += target[i].vertexCount();
+					counters.groupElements[group->index] += target[i].elementCount();
 				}
+			}
+		}
+
+		void WriteCountersCsv(const FrameCounters& c) {
+			fprintf(countersCsv, "%llu,%u,%u,%u,%u,%llu,%llu,%llu", (unsigned long long)c.frame, c.drawCalls, c.programSwitches, c.textureBinds, c.vaoBinds,
+				(unsigned long long)c.vertexBytes, (unsigned long long)c.elementBytes, (unsigned long long)c.textureBytes);
+			for (const BatchGroup* group : Groups()) fprintf(countersCsv, ",%u,%u", c.groupVertices[group->index], c.groupElements[group->index]);
+			fprintf(countersCsv, ",%u,%u,%u\n", c.programBreaks, c.textureBreaks, c.capacityBreaks);
+		}
 
-				glfwSwapBuffers(window);
+		/*Update runs here while the render thread draws, each frame goes through a packet of the queue*/
+		void ThreadedLoop() {
+			MakeCurrent(false);
+			std::thread renderer(&VoiOGLEngine::RenderLoop, this);
+
+			VOI_PROFILE_THREAD("simulation");
+			while (Running()) {
+				VOI_PROFILE_ZONE("Frame");
+				FramePacket *frame = AcquirePacket();
+				frame->commands.reset();
+				frame->clear = false;
+
+				packet = frame;
+				Simulate();
+				SubmitCommandBuffers();
+				packet = nullptr;
+
+				frame->clearColor = clearColor;
+				frames.submit();
 
 				frameCount++;
 
-				glfwPollEvents();
+				PollEvents();
 			}
+
+			frames.close();
+			renderer.join();
+			MakeCurrent(true);
+
 			this->Finish();
 		}
 
+		/*waits while FRAMES_IN_FLIGHT packets are waiting to be drawn*/
+		FramePacket* AcquirePacket() {
+			VOI_PROFILE_ZONE("AcquirePacket");
+			return frames.acquire();
+		}
+
+		void RenderLoop() {
+			VOI_PROFILE_THREAD("render");
+			MakeCurrent(true);
+
+			while (FramePacket *frame = frames.next()) {
+				VOI_PROFILE_ZONE("RenderFrame");
+				glClearColor(frame->clearColor.r, frame->clearColor.g, frame->clearColor.b, frame->clearColor.a);
+				if (frame->clear) ClearBatches();
+
+				Replay(frame->commands);
+				timer.add(PHASE_UPDATE, frame->updateTime);
+				DrawFrame();
+				Present();
+
+				frames.release();
+			}
+
+			MakeCurrent(false);
+		}
+
+		/*the packet's recorder, with the current drawColor and texture*/
+		CommandBuffer& Recorder() {
+			packet->commands.drawColor = drawColor;
+			packet->commands.texture = recordTexture;
+			return packet->commands;
+		}
+
+		/*static layers first, then the batch groups in order, batches with no geometry are skipped*/
+		void DrawFrame() {
+			VOI_PROFILE_ZONE("DrawFrame");
+			timer.begin(PHASE_UPLOAD);
+			UploadFrame();
+			timer.end(PHASE_UPLOAD);
+
+			timer.begin(PHASE_DRAW);
+			timer.begin(ZONE_LAYERS);
+			DrawLayers();
+			timer.end(ZONE_LAYERS);
+
+			ui32 shared = 0;
+			for (const BatchGroup* group : Groups()) {
+				const DrawZone zone = (DrawZone)group->index;
+				timer.begin(zone);
+				if (shared < sharedGroups.size() && sharedGroups[shared].position == group->position) {
+					sharedBatches[shared].DrawUploaded(&batches[group->position], group->count);
+					shared++;
+				}
+				else {
+					for (ui32 i = group->position; i < group->position + group->count; i++) {
+						if (batches[i].vertexCount() > 0) batches[i].DrawBatch(GL_TRIANGLES, true);
+					}
+				}
+				timer.end(zone);
+			}
+
+			timer.begin(ZONE_TRANSLUCENT);
+			DrawTranslucent();
+			timer.end(ZONE_TRANSLUCENT);
+			timer.end(PHASE_DRAW);
+		}
+
+		/*every upload of the frame goes before the first draw, so the two phases can be timed apart*/
+		void UploadFrame() {
+			VOI_PROFILE_ZONE("UploadFrame");
+			for (StaticLayer* layer : layers) {
+				if (!layer->visible) continue;
+				CountGroups(layer->batches);
+				CountGroups(layer->translucentBatches);
+			}
+			CountGroups(batches);
+			if (translucent != nullptr) CountGroups(translucent->batches);
+
+			for (StaticLayer* layer : layers) {
+				if (!layer->visible) continue;
+
+				for (auto &batch : layer->batches) {
+					if (batch.vertexCount() > 0) batch.uploadBatch();
+				}
+				for (auto &batch : layer->translucentBatches) {
+					if (batch.vertexCount() > 0) batch.uploadBatch();
+				}
+			}
+
+			ui32 shared = 0;
+			for (ui32 i = 0; i < batches.size();) {
+				if (shared < sharedGroups.size() && sharedGroups[shared].position == i) {
+					sharedBatches[shared].UploadBatches(&batches[i], sharedGroups[shared].count);
+					i += sharedGroups[shared].count;
+					shared++;
+					continue;
+				}
+
+				if (batches[i].vertexCount() > 0) batches[i].uploadBatch();
+				i++;
+			}
+
+			if (translucent != nullptr && translucentDraws.size() > 0) {
+				for (auto &batch : translucent->batches) {
+					if (batch.vertexCount() > 0) batch.uploadBatch();
+				}
+			}
+		}
+
+		/*the translucent primitives of the frame and of the visible layers sorted together, consecutive ones continuing
+		the same range of the same batch are one draw. a command's batch is set * batches.size() + index, set 0 being
+		the frame's translucent batches and set l + 1 those of layer l*/
+		void DrawTranslucent() {
+			VOI_PROFILE_ZONE("DrawTranslucent");
+			if (translucent == nullptr) return;
+
+			/*the layers go first so they draw under the frame's primitives at the same depth, as their opaque ones do
+			(see DrawQueue::makeKey)*/
+			translucentQueue.clear();
+			for (ui32 l = 0; l < layers.size(); l++) {
+				if (!layers[l]->visible) continue;
+				for (const TranslucentDraw& draw : layers[l]->translucentDraws) {
+					translucentQueue.push(true, draw.z, draw.program, draw.batch, (l + 1) * batches.size() + draw.batch, draw.first, draw.count);
+				}
+			}
+			for (const TranslucentDraw& draw : translucentDraws) {
+				translucentQueue.push(true, draw.z, draw.program, draw.batch, draw.batch, draw.first, draw.count);
+			}
+			if (translucentQueue.size() == 0) return;
+
+			translucentQueue.sort();
+
+			GLState::setBlend(true);
+			GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			GLState::setDepthWrite(false);
+
+			const std::vector<DrawCommand>& commands = translucentQueue.sorted();
+			DrawCommand run = commands[0];
+			for (size_t c = 1; c < commands.size(); c++) {
+				const DrawCommand& command = commands[c];
+				if (command.batch == run.batch && command.first == run.first + run.count) {
+					run.count += command.count;
+					continue;
+				}
+
+				TranslucentBatch(run.batch).DrawRange(run.first, run.count);
+				run = command;
+			}
+			TranslucentBatch(run.batch).DrawRange(run.first, run.count);
+
+			GLState::setDepthWrite(true);
+			GLState::setBlend(false);
+		}
+
+		RenderBatch& TranslucentBatch(ui32 command) {
+			const ui32 set = command / batches.size();
+			const ui32 index = command % batches.size();
+			return set == 0 ? translucent->batches[index] : layers[set - 1]->translucentBatches[index];
+		}
+
+		void DrawLayers() {
+			for (StaticLayer* layer : layers) {
+				if (!layer->visible) continue;
+
+				for (auto &batch : layer->batches) {
+					if (batch.vertexCount() > 0) batch.DrawBatch(GL_TRIANGLES, true);
+				}
+			}
+		}
+
+		//---primitives written into the batches, "color" is the drawColor they were drawn with---//
+
+		void PutFillTriangle(const Vec2f& p1, const Vec2f& p2, const Vec2f& p3, float z, const Pixel& color) {
+			FillShapeView view = ReserveSolidShape(3, 3, z, color.a < 1.f);
+
+			view.vertex(0, p1, z, color);
+			view.vertex(1, p2, z, color);
+			view.vertex(2, p3, z, color);
+
+			view.element(0, 0); view.element(1, 1); view.element(2, 2);
+		}
+
+		void PutFillQuad(const Vec2f& p1, const Vec2f& p2, const Vec2f& p3, const Vec2f& p4, float z, const Pixel& color) {
+			FillShapeView view = ReserveSolidQuads(1, z, color.a < 1.f);
+
+			view.vertex(0, p1, z, color);
+			view.vertex(1, p2, z, color);
+			view.vertex(2, p3, z, color);
+			view.vertex(3, p4, z, color);
+		}
+
+		void PutFillRect(float x, float y, float w, float h, float z, const Pixel& color) {
+			if (spriteInstancing) {
+				ReserveSolidSprites(1, z, color.a < 1.f).sprite(0, x, y, w, h, z, color);
+				return;
+			}
+
+			PutFillQuad(
+				{     x, y     },
+				{ x + w, y     },
+				{ x + w, y + h },
+				{     x, y + h },
+				z, color
+			);
+		}
+
+		void PutTextureTri(const Vec2f& p1, const Vec2f& p2, const Vec2f& p3, float z,
+			const Vec2f& t1, const Vec2f& t2, const Vec2f& t3, const Pixel& color) {
+
+			TexShapeView view = ReserveTexShape(3, 3, z);
+
+			view.vertex(0, p1, z, color, MapTexCoord(t1));
+			view.vertex(1, p2, z, color, MapTexCoord(t2));
+			view.vertex(2, p3, z, color, MapTexCoord(t3));
+
+			view.element(0, 0); view.element(1, 1); view.element(2, 2);
+		}
+
+		void PutTextureQuad(const Vec2f& p1, const Vec2f& p2, const Vec2f& p3, const Vec2f& p4, float z,
+			const Vec2f& t1, const Vec2f& t2, const Vec2f& t3, const Vec2f& t4, const Pixel& color) {
+
+			TexShapeView view = ReserveTexQuads(1, z);
+
+			view.vertex(0, p1, z, color, MapTexCoord(t1));
+			view.vertex(1, p2, z, color, MapTexCoord(t2));
+			view.vertex(2, p3, z, color, MapTexCoord(t3));
+			view.vertex(3, p4, z, color, MapTexCoord(t4));
+		}
+
+		void PutTextureRect(float x, float y, float w, float h, float z,
+			const Vec2f& t1, const Vec2f& t2, const Vec2f& t3, const Vec2f& t4, const Pixel& color) {
+			/*only texture coordinates that form an axis aligned rect fit in a sprite record*/
+			const bool texIsRect = t1.x == t4.x && t2.x == t3.x && t1.y == t2.y && t3.y == t4.y;
+
+			if (spriteInstancing && texIsRect) {
+				ReserveTexSprites(1, z).sprite(0, x, y, w, h, z, color, MapTexCoord(t1), MapTexCoord(t3));
+				return;
+			}
+
+			PutTextureQuad(
+				{ x, y },
+				{ x + w, y },
+				{ x + w, y + h },
+				{ x, y + h },
+				z, 
+				t1, t2, t3, t4, color
+			);
+		}
+
+		/*the vertices carry their own colors, any of them under alpha 1 sends the shape to the translucent pass*/
+		void PutFillShape(const FillVertex2D* vertData, ui32 vertCount, const ui32* elements, ui32 elemCount) {
+			FillShapeView view = ReserveSolidShape(vertCount, elemCount, vertCount > 0 ? vertData[0].pos.z : 0, FillVertex2D::anyTranslucent(vertData, vertCount));
+
+			for (ui32 i = 0; i < vertCount; i++) {
+				view.vertex(i, vertData[i].pos.pos, vertData[i].pos.z, vertData[i].color);
+			}
+			for (ui32 i = 0; i < elemCount; i++) {
+				view.element(i, elements[i]);
+			}
+		}
+
+		void PutTextureShape(const TexVertex2D* vertData, ui32 vertCount, const ui32* elements, ui32 elemCount) {
+			TexShapeView view = ReserveTexShape(vertCount, elemCount, vertCount > 0 ? vertData[0].pos.z : 0);
+
+			for (ui32 i = 0; i < vertCount; i++) {
+				view.vertex(i, vertData[i].pos.pos, vertData[i].pos.z, vertData[i].color, MapTexCoord(vertData[i].texCoord));
+			}
+			for (ui32 i = 0; i < elemCount; i++) {
+				view.element(i, elements[i]);
+			}
+		}
+
+		FillShapeView ReserveSolidShape(ui32 vertCount, ui32 elemCount, float z, bool translucentDraw) {
+			RenderBatch& batch = SolidBatch(translucentDraw);
+			RenderBatch::Reservation res = Submitted(batch, batch.reserve(vertCount, elemCount), z);
+			return { res.vertices, res.elements, res.base };
+		}
+
+		FillShapeView ReserveSolidQuads(ui32 count, float z, bool translucentDraw) {
+			RenderBatch& batch = SolidBatch(translucentDraw);
+			RenderBatch::Reservation res = Submitted(batch, batch.reserveQuads(count), z);
+			return { res.vertices, nullptr, res.base };
+		}
+
+		FillSpriteView ReserveSolidSprites(ui32 count, float z, bool translucentDraw) {
+			RenderBatch& batch = SolidSpriteBatch(translucentDraw);
+			RenderBatch::Reservation res = Submitted(batch, batch.reserveInstances(count), z);
+			return { res.vertices, res.base };
+		}
+
+		TexShapeView ReserveTexShape(ui32 vertCount, ui32 elemCount, float z) {
+			RenderBatch::Reservation res = Submitted(TextureBatch(), TextureBatch().reserve(vertCount, elemCount), z);
+			return { res.vertices, res.elements, res.base, CurrentSlot(), IsAtlasPage(singleTexGroup.current) };
+		}
+
+		TexShapeView ReserveTexQuads(ui32 count, float z) {
+			RenderBatch::Reservation res = Submitted(TextureBatch(), TextureBatch().reserveQuads(count), z);
+			return { res.vertices, nullptr, res.base, CurrentSlot(), IsAtlasPage(singleTexGroup.current) };
+		}
+
+		TexSpriteView ReserveTexSprites(ui32 count, float z) {
+			RenderBatch::Reservation res = Submitted(TextureSpriteBatch(), TextureSpriteBatch().reserveInstances(count), z);
+			return { res.vertices, res.base, CurrentSlot(), IsAtlasPage(singleTexGroup.current) };
+		}
+
+		/*makes handle "batch" the texture of the next textured primitives*/
+		bool SelectTexture(ui32 batch) {
+			if (batch >= ATLAS_HANDLE_BASE && batch - ATLAS_HANDLE_BASE < atlas.regionCount()) {
+				const TextureAtlas::Region& region = atlas.region(batch - ATLAS_HANDLE_BASE);
+
+				singleTexGroup.current = atlas.pageTexture(region.page);
+				memcpy(texRect, region.uvRect, sizeof(texRect));
+				currentAlpha = region.alpha;
+				return true;
+			}
+			if (batch >= 0 && batch < TextureLimit()) {
+				singleTexGroup.current = batch;
+				texRect[0] = texRect[1] = 0.f;
+				texRect[2] = texRect[3] = 1.f;
+				currentAlpha = textureAlpha[batch];
+				return true;
+			}
+			return false;
+		}
+
+		void ClearBatches() {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			for (auto &batch : batches) {
+				batch.clearBatch();
+			}
+			if (translucent != nullptr) {
+				for (auto &batch : translucent->batches) batch.clearBatch();
+				translucentDraws.clear();
+			}
+		}
+
+		/*writes the commands of "buffer" into the batches, each with the color and texture it was recorded with*/
+		void Replay(const CommandBuffer& buffer) {
+			VOI_PROFILE_ZONE("Replay");
+			for (const CommandBuffer::Command& command : buffer.commands) {
+				const bool textured = command.kind == CommandBuffer::TEXTURE_SHAPE || command.kind == CommandBuffer::TEXTURE_QUAD || command.kind == CommandBuffer::TEXTURE_RECT;
+				if (textured && !SelectTexture(command.texture)) continue;
+
+				const FillVertex2D* fill = buffer.fillVertices.data() + command.vertFirst;
+				const TexVertex2D* tex = buffer.texVertices.data() + command.vertFirst;
+				const ui32* elems = buffer.elements.data() + command.elemFirst;
+
+				switch (command.kind) {
+				case CommandBuffer::FILL_SHAPE:
+					PutFillShape(fill, command.vertCount, elems, command.elemCount);
+					break;
+				case CommandBuffer::TEXTURE_SHAPE:
+					PutTextureShape(tex, command.vertCount, elems, command.elemCount);
+					break;
+				case CommandBuffer::FILL_QUAD:
+					PutFillQuad(fill[0].pos.pos, fill[1].pos.pos, fill[2].pos.pos, fill[3].pos.pos, command.z, command.color);
+					break;
+				case CommandBuffer::TEXTURE_QUAD:
+					PutTextureQuad(tex[0].pos.pos, tex[1].pos.pos, tex[2].pos.pos, tex[3].pos.pos, command.z,
+						tex[0].texCoord, tex[1].texCoord, tex[2].texCoord, tex[3].texCoord, command.color);
+					break;
+				case CommandBuffer::FILL_RECT:
+					PutFillRect(fill[0].pos.pos.x, fill[0].pos.pos.y, fill[2].pos.pos.x - fill[0].pos.pos.x, fill[2].pos.pos.y - fill[0].pos.pos.y, command.z, command.color);
+					break;
+				case CommandBuffer::TEXTURE_RECT:
+					PutTextureRect(tex[0].pos.pos.x, tex[0].pos.pos.y, tex[2].pos.pos.x - tex[0].pos.pos.x, tex[2].pos.pos.y - tex[0].pos.pos.y, command.z,
+						tex[0].texCoord, tex[1].texCoord, tex[2].texCoord, tex[3].texCoord, command.color);
+					break;
+				}
+			}
+		}
+
+		ui32 TextureLimit() { return textureSlots ? MAX_TEXTURES : singleTexGroup.count; }
+		/*with the atlas the last TEXTURE_SLOTS textures are kept for its pages, so their batches (one slot batch,
+		or that many single ones) can take the atlas vertex formats, the textures of their own come before*/
+		ui32 OwnTextureLimit() { return atlasTextures ? TextureLimit() - TEXTURE_SLOTS : TextureLimit(); }
+		bool IsAtlasPage(ui32 t) { return atlasTextures && t >= OwnTextureLimit() && t < TextureLimit(); }
+
+		/*packs the image in an atlas page, opening a new page (one more engine texture) when none has room*/
+		ui32 AddAtlasTexture(ui32 width, ui32 height, const ui8* data, ui32 channels) {
+			VOI_PROFILE_ZONE("VoiOGLEngine::AddAtlasTexture");
+			i32 region = atlas.add(width, height, data, channels);
+			if (region < 0) {
+				if (OwnTextureLimit() + atlas.pageCount() >= TextureLimit()) return -1;
+
+				const ui32 t = OwnTextureLimit() + atlas.pageCount();
+				atlas.addPage(t, textures[t]);
+
+				AssignTexture(batches, t);
+				if (translucent != nullptr) AssignTexture(translucent->batches, t);
+				for (StaticLayer* layer : layers) {
+					AssignTexture(layer->batches, t);
+					AssignTexture(layer->translucentBatches, t);
+				}
+
+				region = atlas.add(width, height, data, channels);
+				if (region < 0) return -1;
+			}
+			return ATLAS_HANDLE_BASE + region;
+		}
+
+		/*binds texture "t" in every batch that draws it*/
+		void AssignTexture(std::vector<RenderBatch>& target, ui32 t) {
+			if (target.empty()) return;
+			if (t < singleTexGroup.count) {
+				target[t + singleTexGroup.position].addTexture(textures[t], 0);
+				target[t + texSpriteGroup.position].addTexture(textures[t], 0);
+			}
+			if (textureSlots) {
+				target[t / TEXTURE_SLOTS + slotTexGroup.position].addTexture(textures[t], t % TEXTURE_SLOTS);
+				target[t / TEXTURE_SLOTS + slotSpriteGroup.position].addTexture(textures[t], t % TEXTURE_SLOTS);
+			}
+		}
+
+		/*batches the draw calls currently write to, the recording layer's when there is one, else the translucent
+		layer's for translucent primitives*/
+		std::vector<RenderBatch>& TargetBatches(bool isTranslucent) {
+			const bool sorted = isTranslucent && translucent != nullptr;
+			if (recording != nullptr) return sorted ? recording->translucentBatches : recording->batches;
+			if (sorted) return translucent->batches;
+			return batches;
+		}
+
+		/*batch "index" of TargetBatches, while editing a layer only the edited batch can be drawn to*/
+		RenderBatch& TargetBatch(bool isTranslucent, ui32 index) {
+			std::vector<RenderBatch>& target = TargetBatches(isTranslucent);
+			if (editingBatch >= 0 && ((i32)index != editingBatch || (&target != &recording->batches) != editingTranslucent)) throw "Outside of range Exception";
+			return target[index];
+		}
+
+		RenderBatch& SolidBatch(bool translucentDraw) { return TargetBatch(translucentDraw, solidGroup.current + solidGroup.position); }
+		RenderBatch& TextureBatch() {
+			if (textureSlots) return TargetBatch(currentAlpha, singleTexGroup.current / TEXTURE_SLOTS + slotTexGroup.position);
+			return TargetBatch(currentAlpha, singleTexGroup.current + singleTexGroup.position);
+		}
+		RenderBatch& SolidSpriteBatch(bool translucentDraw) { return TargetBatch(translucentDraw, solidSpriteGroup.current + solidSpriteGroup.position); }
+		RenderBatch& TextureSpriteBatch() {
+			if (textureSlots) return TargetBatch(currentAlpha, singleTexGroup.current / TEXTURE_SLOTS + slotSpriteGroup.position);
+			return TargetBatch(currentAlpha, singleTexGroup.current + texSpriteGroup.position);
+		}
+
+		/*unit the current texture samples from in the slot batches, -1 without them*/
+		i32 CurrentSlot() { return textureSlots ? (i32)(singleTexGroup.current % TEXTURE_SLOTS) : -1; }
+
+		/*the render thread owns the batches while Update records a packet*/
+		void RequireBatches() {
+			if (packet != nullptr) throw "Render thread Exception";
+		}
+
+		/*marks the reservation when recording a layer, queues it when it went to translucent batches (an edit
+		rewrites a primitive already queued)*/
+		RenderBatch::Reservation Submitted(RenderBatch& batch, const RenderBatch::Reservation& res, float z) {
+			if (recording != nullptr) {
+				const ui32 layer = std::find(layers.begin(), layers.end(), recording) - layers.begin();
+				const bool isTranslucent = Holds(recording->translucentBatches, batch);
+				const ui32 index = &batch - (isTranslucent ? recording->translucentBatches.data() : recording->batches.data());
+
+				lastMark = { layer, index, res.base, isTranslucent };
+				if (isTranslucent && editingBatch < 0) recording->translucentDraws.push_back({ z, batch.programId(), index, res.first, res.count });
+			}
+			else if (translucent != nullptr && Holds(translucent->batches, batch)) {
+				const ui32 index = &batch - translucent->batches.data();
+				translucentDraws.push_back({ z, batch.programId(), index, res.first, res.count });
+			}
+			return res;
+		}
+
+		static bool Holds(const std::vector<RenderBatch>& target, const RenderBatch& batch) {
+			return &batch >= target.data() && &batch < target.data() + target.size();
+		}
+
 		static void viewportResize(GLFWwindow* window, int width, int height) {
 			glViewport(0, 0, width, height);
 		}
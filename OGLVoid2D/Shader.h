@@ -1,6 +1,8 @@
 #pragma once
 
 #include <glad/glad.h>
+#include "GLState.h"
+#include "Profiler.h"
 
 #include <string>
 #include <vector>
@@ -15,15 +17,7 @@ public:
 		std::string vertexCode = vertexStr, fragmentCode = fragmentStr;
 
 		if (path) {
-			std::ifstream vertexFile(vertexStr), fragmentFile(fragmentStr);
-			std::stringstream vertexStream, fragmentStream;
-
-			vertexStream << vertexFile.rdbuf();
-			fragmentStream << fragmentFile.rdbuf();
-
-			vertexCode = vertexStream.str(); fragmentCode = fragmentStream.str();
-
-			vertexFile.close(); fragmentFile.close();
+			vertexCode = readFile(vertexStr); fragmentCode = readFile(fragmentStr);
 		}
 
 		id = programLinking(vertexCode, fragmentCode);
@@ -39,7 +33,9 @@ public:
 		}
 	}
 
-	void use() { glUseProgram(id); }
+	void use() { GLState::useProgram(id); }
+
+	uint32_t getId() { return id; }
 
 	void setBool(const std::string& name, bool val) {
 		glUniform1i(
@@ -84,7 +80,24 @@ public:
 		);
 	}
 
+	static std::string readFile(const std::string& path) {
+		VOI_PROFILE_ZONE("Shader::readFile");
+		std::ifstream file(path);
+		std::stringstream stream;
+
+		stream << file.rdbuf();
+		file.close();
+
+		return stream.str();
+	}
+
+	/*links a program from the shader files at the given paths*/
+	static uint32_t programLoading(const std::string& vertexPath, const std::string& fragmentPath) {
+		return programLinking(readFile(vertexPath), readFile(fragmentPath));
+	}
+
 	static uint32_t shaderCompilation(const char* shaderSource, GLenum type) {
+		VOI_PROFILE_ZONE("Shader::shaderCompilation");
 		uint32_t shader;
 		shader = glCreateShader(type);
 
@@ -111,6 +124,7 @@ public:
 	}
 
 	static uint32_t programLinking(const std::string& vertexCode,const std::string& fragmentCode) {
+		VOI_PROFILE_ZONE("Shader::programLinking");
 		uint32_t linkId = glCreateProgram();
 
 		/*compile shaders*/
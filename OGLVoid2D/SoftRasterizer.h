@@ -0,0 +1,626 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VOI_SOFT_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "utilDefs.h"
+#include "Renderer.h"
+#include "DrawQueue.h"
+
+namespace voi {
+	/*cpu rasterizer drawing what a CommandBuffer recorded the way the gl path does with the default EngineConfig:
+	solid and textured triangles with per vertex color, depth tested with GL_LEQUAL, texels mixed with the color as
+	texture.frag does, opaque primitives first and translucent ones blended back to front with depth writes off.
+	the screen is cut in TILE_SIZE tiles, triangles are binned to the tiles they touch and the tiles are rasterized
+	by every core, 4 pixels at a time with sse2 when available. textures are filtered like GL_LINEAR_MIPMAP_LINEAR
+	from 2x2 box filtered levels, the level of detail is the same over a triangle since nothing is perspective*/
+	class SoftRasterizer {
+	public:
+		static const i32 TILE_SIZE = 64;
+		static const i32 SUBPIXEL_BITS = 4;
+		static const i32 SUBPIXELS = 1 << SUBPIXEL_BITS;
+		// pixels past the screen edges kept before clipping, keeps the fixed point edge values in range
+		static const i32 GUARD_BAND = 8192;
+
+	private:
+		struct SoftLevel {
+			i32 width, height;
+			std::vector<ui8> rgba;
+		};
+
+		struct SoftTexture {
+			// level 0 is the image, each next one half its size down to 1x1
+			std::vector<SoftLevel> levels;
+			bool alpha = false;
+			bool loaded = false;
+			// GL_CLAMP_TO_EDGE instead of GL_REPEAT
+			bool clamp = false;
+		};
+
+		/*window position (pixels, y up) and what's interpolated*/
+		struct Vertex {
+			float x, y;
+			float attr[7];
+		};
+		enum Attribute { ATTR_Z, ATTR_R, ATTR_G, ATTR_B, ATTR_A, ATTR_U, ATTR_V, ATTR_COUNT };
+
+		struct Triangle {
+			// pixel bounds, inclusive
+			i32 minX, minY, maxX, maxY;
+			// edge "i" is A * px + B * py + C in subpixels, a pixel is covered when every edge + bias is 0 or more
+			i64 A[3], B[3], C[3];
+			i32 bias[3];
+			// attribute = plane[0] + plane[1] * x + plane[2] * y at the center of pixel x, y
+			float plane[ATTR_COUNT][3];
+			const SoftTexture* texture;
+			float lod;
+			bool blend;
+		};
+
+		ui32 width, height;
+		// rows padded to 4 pixels, bottom row first like gl
+		ui32 stride;
+		std::vector<ui32> color;
+		std::vector<float> depth;
+
+		std::vector<SoftTexture> textures;
+		std::vector<Triangle> triangles;
+		std::vector<std::vector<ui32>> bins;
+		ui32 tilesX, tilesY;
+		DrawQueue order;
+
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		ui64 generation = 0;
+		ui32 running = 0;
+		bool quit = false;
+		std::atomic<ui32> nextTile{ 0 };
+
+	public:
+		/*"threads" 0 uses every core*/
+		SoftRasterizer(ui32 _width, ui32 _height, ui32 threads = 0) : width(_width), height(_height) {
+			stride = (width + 3) & ~3u;
+			color.resize(stride * height);
+			depth.resize(stride * height);
+
+			tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+			tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+			bins.resize(tilesX * tilesY);
+
+			if (threads == 0) threads = std::thread::hardware_concurrency();
+			/*the calling thread rasterizes too*/
+			for (ui32 i = 1; i < threads; i++) workers.emplace_back(&SoftRasterizer::WorkerLoop, this);
+
+			clear({ 0.f, 0.f, 0.f, 0.f });
+		}
+
+		~SoftRasterizer() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				quit = true;
+			}
+			wake.notify_all();
+			for (std::thread& worker : workers) worker.join();
+		}
+
+		/*the image textured commands with "handle" sample, "channels" 3 or 4, use the handles AddTexture gave.
+		images the atlas takes are clamped to their edges like the padded atlas regions and stop at level 1 like
+		the atlas pages, the rest repeat. pass "clampEdges" false for all of them when the engine runs without atlasTextures*/
+		void setTexture(ui32 handle, i32 texWidth, i32 texHeight, const ui8* data, ui32 channels = 4) {
+			setTexture(handle, texWidth, texHeight, data, channels, TextureAtlas::fits(texWidth, texHeight));
+		}
+		void setTexture(ui32 handle, i32 texWidth, i32 texHeight, const ui8* data, ui32 channels, bool clampEdges) {
+			if (handle >= textures.size()) textures.resize(handle + 1);
+			SoftTexture& texture = textures[handle];
+			texture.clamp = clampEdges;
+
+			texture.levels.resize(1);
+			SoftLevel& image = texture.levels[0];
+			image.width = texWidth;
+			image.height = texHeight;
+			image.rgba.resize(texWidth * texHeight * 4);
+			texture.alpha = false;
+			texture.loaded = true;
+			for (i32 i = 0; i < texWidth * texHeight; i++) {
+				image.rgba[i * 4 + 0] = data[i * channels + 0];
+				image.rgba[i * 4 + 1] = data[i * channels + 1];
+				image.rgba[i * 4 + 2] = data[i * channels + 2];
+				image.rgba[i * 4 + 3] = channels == 4 ? data[i * channels + 3] : 255;
+				if (image.rgba[i * 4 + 3] < 255) texture.alpha = true;
+			}
+
+			const ui32 levelCount = clampEdges ? 2 : 32;
+			while (texture.levels.size() < levelCount && (texture.levels.back().width > 1 || texture.levels.back().height > 1)) {
+				texture.levels.push_back(Downsample(texture.levels.back()));
+			}
+		}
+
+		void clear(const Pixel& p) {
+			const ui32 packed = Pack(p.r, p.g, p.b, p.a);
+			std::fill(color.begin(), color.end(), packed);
+			std::fill(depth.begin(), depth.end(), 1.f);
+		}
+
+		/*rasterizes every command of "buffer" on top of what's drawn*/
+		void draw(const CommandBuffer& buffer) {
+			Setup(buffer);
+			if (triangles.empty()) return;
+
+			nextTile = 0;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				generation++;
+				running = workers.size();
+			}
+			wake.notify_all();
+
+			RasterTiles();
+
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this] { return running == 0; });
+		}
+
+		/*4 bytes per pixel, rows from the top, like VoiOGLEngine::ReadPixels*/
+		void readPixels(std::vector<ui8>& rgba) {
+			rgba.resize(width * height * 4);
+			for (ui32 y = 0; y < height; y++) {
+				memcpy(rgba.data() + (height - 1 - y) * width * 4, color.data() + y * stride, width * 4);
+			}
+		}
+
+		ui32 getWidth() { return width; }
+		ui32 getHeight() { return height; }
+
+	private:
+		static ui32 Pack(float r, float g, float b, float a) {
+			return (ui32)ToByte(r) | ((ui32)ToByte(g) << 8) | ((ui32)ToByte(b) << 16) | ((ui32)ToByte(a) << 24);
+		}
+		static ui8 ToByte(float c) {
+			c = c < 0.f ? 0.f : (c > 1.f ? 1.f : c);
+			return (ui8)(c * 255.f + 0.5f);
+		}
+
+		//---setup---//
+
+		/*the commands in the order the gl path ends up drawing them (see DrawQueue::makeKey), turned into binned triangles.
+		the program field of the key stands for the batch group, so opaque primitives at the same depth keep the group order*/
+		void Setup(const CommandBuffer& buffer) {
+			triangles.clear();
+			for (std::vector<ui32>& bin : bins) bin.clear();
+			order.clear();
+
+			for (ui32 i = 0; i < buffer.commands.size(); i++) {
+				const CommandBuffer::Command& command = buffer.commands[i];
+				const SoftTexture* texture = nullptr;
+				if (Textured(command.kind)) {
+					if (command.texture >= textures.size() || !textures[command.texture].loaded) continue;
+					texture = &textures[command.texture];
+				}
+
+				bool translucent = texture != nullptr ? texture->alpha : command.color.a < 1.f;
+				/*shapes carry their own colors, like PutFillShape*/
+				if (command.kind == CommandBuffer::FILL_SHAPE) translucent = FillVertex2D::anyTranslucent(&buffer.fillVertices[command.vertFirst], command.vertCount);
+				const ui32 group = command.kind == CommandBuffer::FILL_RECT ? 1 : (command.kind == CommandBuffer::TEXTURE_RECT ? 3 : (texture != nullptr ? 2 : 0));
+				order.push(translucent, command.z, group, 0, i, 0, 0);
+			}
+			order.sort();
+
+			for (const DrawCommand& sorted : order.sorted()) {
+				const CommandBuffer::Command& command = buffer.commands[sorted.batch];
+				const bool blend = (sorted.key >> 63) != 0;
+				const SoftTexture* texture = Textured(command.kind) ? &textures[command.texture] : nullptr;
+
+				Vertex verts[4];
+				const ui32 quad[] = { 0, 1, 2, 0, 2, 3 };
+
+				switch (command.kind) {
+				case CommandBuffer::FILL_SHAPE:
+				case CommandBuffer::TEXTURE_SHAPE:
+					for (ui32 e = 0; e + 2 < command.elemCount; e += 3) {
+						const ui32* elems = buffer.elements.data() + command.elemFirst + e;
+						for (ui32 k = 0; k < 3; k++) LoadVertex(buffer, command, command.vertFirst + elems[k], verts[k]);
+						AddTriangle(verts[0], verts[1], verts[2], texture, blend);
+					}
+					break;
+				default:
+					for (ui32 k = 0; k < 4; k++) LoadVertex(buffer, command, command.vertFirst + k, verts[k]);
+					AddTriangle(verts[quad[0]], verts[quad[1]], verts[quad[2]], texture, blend);
+					AddTriangle(verts[quad[3]], verts[quad[4]], verts[quad[5]], texture, blend);
+					break;
+				}
+			}
+		}
+
+		/*the next mipmap level, odd edges keep their last texel out of the average*/
+		static SoftLevel Downsample(const SoftLevel& source) {
+			SoftLevel level;
+			level.width = std::max(1, source.width / 2);
+			level.height = std::max(1, source.height / 2);
+			level.rgba.resize(level.width * level.height * 4);
+			for (i32 y = 0; y < level.height; y++) {
+				const i32 y0 = std::min(y * 2, source.height - 1), y1 = std::min(y * 2 + 1, source.height - 1);
+				for (i32 x = 0; x < level.width; x++) {
+					const i32 x0 = std::min(x * 2, source.width - 1), x1 = std::min(x * 2 + 1, source.width - 1);
+					for (ui32 k = 0; k < 4; k++) {
+						const ui32 sum = source.rgba[(y0 * source.width + x0) * 4 + k] + source.rgba[(y0 * source.width + x1) * 4 + k] +
+							source.rgba[(y1 * source.width + x0) * 4 + k] + source.rgba[(y1 * source.width + x1) * 4 + k];
+						level.rgba[(y * level.width + x) * 4 + k] = (ui8)((sum + 2) / 4);
+					}
+				}
+			}
+			return level;
+		}
+
+		static bool Textured(ui8 kind) {
+			return kind == CommandBuffer::TEXTURE_SHAPE || kind == CommandBuffer::TEXTURE_QUAD || kind == CommandBuffer::TEXTURE_RECT;
+		}
+
+		void LoadVertex(const CommandBuffer& buffer, const CommandBuffer::Command& command, ui32 index, Vertex& v) {
+			const Pos2D* pos;
+			const Pixel* c;
+			if (Textured(command.kind)) {
+				const TexVertex2D& tex = buffer.texVertices[index];
+				pos = &tex.pos;
+				c = &tex.color;
+				v.attr[ATTR_U] = tex.texCoord.x;
+				v.attr[ATTR_V] = tex.texCoord.y;
+			}
+			else {
+				const FillVertex2D& fill = buffer.fillVertices[index];
+				pos = &fill.pos;
+				c = &fill.color;
+				v.attr[ATTR_U] = v.attr[ATTR_V] = 0.f;
+			}
+
+			v.x = (pos->pos.x + 1.f) * 0.5f * width;
+			v.y = (pos->pos.y + 1.f) * 0.5f * height;
+			v.attr[ATTR_Z] = pos->z;
+			v.attr[ATTR_R] = c->r;
+			v.attr[ATTR_G] = c->g;
+			v.attr[ATTR_B] = c->b;
+			v.attr[ATTR_A] = c->a;
+		}
+
+		/*clips to the guard band when needed, the depth range is clipped per pixel*/
+		void AddTriangle(const Vertex& a, const Vertex& b, const Vertex& c, const SoftTexture* texture, bool blend) {
+			const float lowX = -(float)GUARD_BAND, highX = (float)(width + GUARD_BAND);
+			const float lowY = -(float)GUARD_BAND, highY = (float)(height + GUARD_BAND);
+
+			bool inside = true;
+			for (const Vertex* v : { &a, &b, &c }) {
+				if (!(v->x >= lowX && v->x <= highX && v->y >= lowY && v->y <= highY)) inside = false;
+			}
+			if (inside) {
+				SetupTriangle(a, b, c, texture, blend);
+				return;
+			}
+
+			Vertex polygon[9] = { a, b, c };
+			Vertex clipped[9];
+			ui32 count = 3;
+			/*x >= lowX, x <= highX, y >= lowY, y <= highY*/
+			for (ui32 plane = 0; plane < 4 && count > 0; plane++) {
+				ui32 out = 0;
+				for (ui32 i = 0; i < count; i++) {
+					const Vertex& from = polygon[i];
+					const Vertex& to = polygon[(i + 1) % count];
+					const float df = PlaneDistance(from, plane, lowX, highX, lowY, highY);
+					const float dt = PlaneDistance(to, plane, lowX, highX, lowY, highY);
+
+					if (df >= 0.f) clipped[out++] = from;
+					if ((df >= 0.f) != (dt >= 0.f)) {
+						const float t = df / (df - dt);
+						Vertex& v = clipped[out++];
+						v.x = from.x + (to.x - from.x) * t;
+						v.y = from.y + (to.y - from.y) * t;
+						for (ui32 k = 0; k < ATTR_COUNT; k++) v.attr[k] = from.attr[k] + (to.attr[k] - from.attr[k]) * t;
+					}
+				}
+				count = out;
+				for (ui32 i = 0; i < count; i++) polygon[i] = clipped[i];
+			}
+
+			for (ui32 i = 1; i + 1 < count; i++) SetupTriangle(polygon[0], polygon[i], polygon[i + 1], texture, blend);
+		}
+
+		static float PlaneDistance(const Vertex& v, ui32 plane, float lowX, float highX, float lowY, float highY) {
+			switch (plane) {
+			case 0: return v.x - lowX;
+			case 1: return highX - v.x;
+			case 2: return v.y - lowY;
+			default: return highY - v.y;
+			}
+		}
+
+		void SetupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, const SoftTexture* texture, bool blend) {
+			const Vertex* v[3] = { &v0, &v1, &v2 };
+			i64 X[3], Y[3];
+			for (ui32 i = 0; i < 3; i++) {
+				X[i] = (i64)std::floor(v[i]->x * SUBPIXELS + 0.5f);
+				Y[i] = (i64)std::floor(v[i]->y * SUBPIXELS + 0.5f);
+			}
+
+			i64 area = (X[1] - X[0]) * (Y[2] - Y[0]) - (Y[1] - Y[0]) * (X[2] - X[0]);
+			if (area == 0) return;
+			/*no culling in the gl path, clockwise triangles are turned counter clockwise*/
+			if (area < 0) {
+				std::swap(v[1], v[2]);
+				std::swap(X[1], X[2]);
+				std::swap(Y[1], Y[2]);
+				area = -area;
+			}
+
+			Triangle t;
+			t.texture = texture;
+			t.blend = blend;
+
+			const i64 minX = std::min(X[0], std::min(X[1], X[2])), maxX = std::max(X[0], std::max(X[1], X[2]));
+			const i64 minY = std::min(Y[0], std::min(Y[1], Y[2])), maxY = std::max(Y[0], std::max(Y[1], Y[2]));
+			/*pixels whose center can be inside*/
+			t.minX = (i32)std::max<i64>(0, (minX - SUBPIXELS / 2 + SUBPIXELS - 1) >> SUBPIXEL_BITS);
+			t.minY = (i32)std::max<i64>(0, (minY - SUBPIXELS / 2 + SUBPIXELS - 1) >> SUBPIXEL_BITS);
+			t.maxX = (i32)std::min<i64>(width - 1, (maxX - SUBPIXELS / 2) >> SUBPIXEL_BITS);
+			t.maxY = (i32)std::min<i64>(height - 1, (maxY - SUBPIXELS / 2) >> SUBPIXEL_BITS);
+			if (t.minX > t.maxX || t.minY > t.maxY) return;
+
+			for (ui32 i = 0; i < 3; i++) {
+				const ui32 j = (i + 1) % 3;
+				t.A[i] = -(Y[j] - Y[i]);
+				t.B[i] = X[j] - X[i];
+				t.C[i] = -(t.A[i] * X[i] + t.B[i] * Y[i]);
+				/*top left rule, a center right on the edge belongs to the triangle whose top or left edge it is*/
+				const bool topLeft = (Y[i] == Y[j] && X[j] < X[i]) || Y[j] < Y[i];
+				t.bias[i] = topLeft ? 0 : -1;
+			}
+
+			/*planes from the snapped positions, evaluated at pixel centers*/
+			const float x0 = X[0] / (float)SUBPIXELS, y0 = Y[0] / (float)SUBPIXELS;
+			const float dx1 = X[1] / (float)SUBPIXELS - x0, dy1 = Y[1] / (float)SUBPIXELS - y0;
+			const float dx2 = X[2] / (float)SUBPIXELS - x0, dy2 = Y[2] / (float)SUBPIXELS - y0;
+			const float invArea = 1.f / (dx1 * dy2 - dy1 * dx2);
+			for (ui32 k = 0; k < ATTR_COUNT; k++) {
+				const float f0 = v[0]->attr[k], df1 = v[1]->attr[k] - f0, df2 = v[2]->attr[k] - f0;
+				const float dfdx = (df1 * dy2 - df2 * dy1) * invArea;
+				const float dfdy = (df2 * dx1 - df1 * dx2) * invArea;
+				t.plane[k][0] = f0 + dfdx * (0.5f - x0) + dfdy * (0.5f - y0);
+				t.plane[k][1] = dfdx;
+				t.plane[k][2] = dfdy;
+			}
+
+			/*texels per pixel along the axis that steps the most, log2 of it*/
+			t.lod = 0.f;
+			if (texture != nullptr) {
+				const float texW = (float)texture->levels[0].width, texH = (float)texture->levels[0].height;
+				const float alongX = std::hypot(t.plane[ATTR_U][1] * texW, t.plane[ATTR_V][1] * texH);
+				const float alongY = std::hypot(t.plane[ATTR_U][2] * texW, t.plane[ATTR_V][2] * texH);
+				const float rho = std::max(alongX, alongY);
+				if (rho > 0.f) t.lod = std::log2(rho);
+			}
+
+			const ui32 index = triangles.size();
+			triangles.push_back(t);
+			for (i32 ty = t.minY / TILE_SIZE; ty <= t.maxY / TILE_SIZE; ty++) {
+				for (i32 tx = t.minX / TILE_SIZE; tx <= t.maxX / TILE_SIZE; tx++) bins[ty * tilesX + tx].push_back(index);
+			}
+		}
+
+		//---rasterization---//
+
+		void WorkerLoop() {
+			ui64 seen = 0;
+			while (true) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [this, seen] { return quit || generation != seen; });
+					if (quit) return;
+					seen = generation;
+				}
+
+				RasterTiles();
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					running--;
+				}
+				done.notify_one();
+			}
+		}
+
+		/*each tile is drawn by one thread, with its triangles in order*/
+		void RasterTiles() {
+			const ui32 tileCount = tilesX * tilesY;
+			for (ui32 tile = nextTile++; tile < tileCount; tile = nextTile++) {
+				const i32 tileX = (tile % tilesX) * TILE_SIZE, tileY = (tile / tilesX) * TILE_SIZE;
+				for (ui32 index : bins[tile]) RasterTriangle(triangles[index], tileX, tileY);
+			}
+		}
+
+		static i32 Saturate(i64 value) {
+			/*far outside values only need their sign, the steps across a tile can't flip it*/
+			const i64 limit = 1 << 30;
+			return (i32)(value > limit ? limit : (value < -limit ? -limit : value));
+		}
+
+		void RasterTriangle(const Triangle& t, i32 tileX, i32 tileY) {
+			const i32 x0 = std::max(t.minX, tileX) & ~3, x1 = std::min(std::min(t.maxX, tileX + TILE_SIZE - 1), (i32)width - 1);
+			const i32 y0 = std::max(t.minY, tileY), y1 = std::min(t.maxY, tileY + TILE_SIZE - 1);
+
+			for (i32 y = y0; y <= y1; y++) {
+				const i64 py = (i64)y * SUBPIXELS + SUBPIXELS / 2;
+				const i64 px = (i64)x0 * SUBPIXELS + SUBPIXELS / 2;
+				i32 edge[3], step[3];
+				for (ui32 i = 0; i < 3; i++) {
+					edge[i] = Saturate(t.A[i] * px + t.B[i] * py + t.C[i] + t.bias[i]);
+					step[i] = (i32)(t.A[i] * SUBPIXELS);
+				}
+
+				ui32* colorRow = color.data() + y * stride;
+				float* depthRow = depth.data() + y * stride;
+
+#ifdef VOI_SOFT_SSE2
+				const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+				__m128i e[3], e4[3];
+				for (ui32 i = 0; i < 3; i++) {
+					e[i] = _mm_add_epi32(_mm_set1_epi32(edge[i]), MulLanes(lanes, step[i]));
+					e4[i] = _mm_set1_epi32(step[i] * 4);
+				}
+				const __m128 laneX = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+				const __m128 zRow = _mm_set1_ps(t.plane[ATTR_Z][0] + t.plane[ATTR_Z][2] * y);
+				const __m128 dzdx = _mm_set1_ps(t.plane[ATTR_Z][1]);
+				const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+
+				for (i32 x = x0; x <= x1; x += 4) {
+					/*sign bit clear on every edge*/
+					__m128i covered = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(e[0], e[1]), e[2]), _mm_set1_epi32(-1));
+					covered = _mm_and_si128(covered, _mm_cmpgt_epi32(_mm_set1_epi32(x1 - x + 1), lanes));
+					for (ui32 i = 0; i < 3; i++) e[i] = _mm_add_epi32(e[i], e4[i]);
+					if (_mm_movemask_epi8(covered) == 0) continue;
+
+					const __m128 xs = _mm_add_ps(_mm_set1_ps((float)x), laneX);
+					const __m128 d = _mm_add_ps(_mm_mul_ps(_mm_add_ps(zRow, _mm_mul_ps(dzdx, xs)), half), half);
+					const __m128 stored = _mm_loadu_ps(depthRow + x);
+					const __m128 pass = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(d, zero), _mm_cmple_ps(d, one)), _mm_cmple_ps(d, stored));
+					const __m128 mask = _mm_and_ps(pass, _mm_castsi128_ps(covered));
+					const i32 bits = _mm_movemask_ps(mask);
+					if (bits == 0) continue;
+
+					if (t.texture == nullptr && !t.blend) {
+						ShadeSolid4(t, xs, (float)y, mask, colorRow + x);
+						_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, d), _mm_andnot_ps(mask, stored)));
+						continue;
+					}
+
+					float ds[4];
+					_mm_storeu_ps(ds, d);
+					for (i32 lane = 0; lane < 4; lane++) {
+						if (bits & (1 << lane)) ShadePixel(t, x + lane, y, ds[lane], colorRow + x + lane, depthRow + x + lane);
+					}
+				}
+#else
+				for (i32 x = x0; x <= x1; x++) {
+					const bool covered = (edge[0] | edge[1] | edge[2]) >= 0;
+					for (ui32 i = 0; i < 3; i++) edge[i] += step[i];
+					if (!covered) continue;
+
+					const float d = (t.plane[ATTR_Z][0] + t.plane[ATTR_Z][1] * x + t.plane[ATTR_Z][2] * y) * 0.5f + 0.5f;
+					if (d < 0.f || d > 1.f || d > depthRow[x]) continue;
+					ShadePixel(t, x, y, d, colorRow + x, depthRow + x);
+				}
+#endif
+			}
+		}
+
+#ifdef VOI_SOFT_SSE2
+		/*lanes * factor, sse2 has no 32 bit low multiply*/
+		static __m128i MulLanes(__m128i lanes, i32 factor) {
+			alignas(16) i32 values[4];
+			_mm_store_si128((__m128i*)values, lanes);
+			return _mm_setr_epi32(values[0] * factor, values[1] * factor, values[2] * factor, values[3] * factor);
+		}
+
+		/*default.frag for 4 pixels, stores the covered ones*/
+		void ShadeSolid4(const Triangle& t, __m128 xs, float y, __m128 mask, ui32* dst) {
+			const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f), scale = _mm_set1_ps(255.f), half = _mm_set1_ps(0.5f);
+			__m128i packed = _mm_setzero_si128();
+			for (ui32 k = 0; k < 4; k++) {
+				const float* plane = t.plane[ATTR_R + k];
+				__m128 c = _mm_add_ps(_mm_set1_ps(plane[0] + plane[2] * y), _mm_mul_ps(_mm_set1_ps(plane[1]), xs));
+				c = _mm_min_ps(_mm_max_ps(c, zero), one);
+				const __m128i byte = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, scale), half));
+				packed = _mm_or_si128(packed, _mm_slli_epi32(byte, 8 * k));
+			}
+
+			const __m128i old = _mm_loadu_si128((const __m128i*)dst);
+			const __m128i keep = _mm_castps_si128(mask);
+			_mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_and_si128(keep, packed), _mm_andnot_si128(keep, old)));
+		}
+#endif
+
+		float Interpolate(const Triangle& t, Attribute k, i32 x, i32 y) {
+			return t.plane[k][0] + t.plane[k][1] * x + t.plane[k][2] * y;
+		}
+
+		/*texture.frag or default.frag, then the opaque write or the blend of the translucent pass*/
+		void ShadePixel(const Triangle& t, i32 x, i32 y, float d, ui32* dst, float* depthDst) {
+			float c[4] = { Interpolate(t, ATTR_R, x, y), Interpolate(t, ATTR_G, x, y), Interpolate(t, ATTR_B, x, y), Interpolate(t, ATTR_A, x, y) };
+
+			if (t.texture != nullptr) {
+				float texel[4];
+				Sample(*t.texture, Interpolate(t, ATTR_U, x, y), Interpolate(t, ATTR_V, x, y), t.lod, texel);
+				/*mix(texture, vec4(color.rgb, 1), color.a)*/
+				const float a = c[3];
+				for (ui32 k = 0; k < 3; k++) c[k] = texel[k] + (c[k] - texel[k]) * a;
+				c[3] = texel[3] + (1.f - texel[3]) * a;
+			}
+
+			if (!t.blend) {
+				*dst = Pack(c[0], c[1], c[2], c[3]);
+				*depthDst = d;
+				return;
+			}
+
+			/*GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA on every channel, no depth write*/
+			const float a = c[3] < 0.f ? 0.f : (c[3] > 1.f ? 1.f : c[3]);
+			float out[4];
+			for (ui32 k = 0; k < 4; k++) {
+				const float src = c[k] < 0.f ? 0.f : (c[k] > 1.f ? 1.f : c[k]);
+				out[k] = src * a + ((*dst >> (8 * k)) & 0xff) / 255.f * (1.f - a);
+			}
+			*dst = Pack(out[0], out[1], out[2], out[3]);
+		}
+
+		/*GL_LINEAR when magnified, GL_LINEAR_MIPMAP_LINEAR when minified*/
+		static void Sample(const SoftTexture& texture, float u, float v, float lod, float out[4]) {
+			const ui32 last = texture.levels.size() - 1;
+			if (lod <= 0.f || last == 0) {
+				SampleLevel(texture.levels[0], texture.clamp, u, v, out);
+				return;
+			}
+
+			const ui32 level = std::min((ui32)lod, last);
+			const float weight = level == last ? 0.f : lod - level;
+			SampleLevel(texture.levels[level], texture.clamp, u, v, out);
+			if (weight <= 0.f) return;
+
+			float next[4];
+			SampleLevel(texture.levels[level + 1], texture.clamp, u, v, next);
+			for (ui32 k = 0; k < 4; k++) out[k] += (next[k] - out[k]) * weight;
+		}
+
+		static void SampleLevel(const SoftLevel& texture, bool clamp, float u, float v, float out[4]) {
+			const float fx = u * texture.width - 0.5f, fy = v * texture.height - 0.5f;
+			const float flX = std::floor(fx), flY = std::floor(fy);
+			const float wx = fx - flX, wy = fy - flY;
+
+			const i32 ix0 = Wrap((i32)flX, texture.width, clamp), ix1 = Wrap((i32)flX + 1, texture.width, clamp);
+			const i32 iy0 = Wrap((i32)flY, texture.height, clamp), iy1 = Wrap((i32)flY + 1, texture.height, clamp);
+			const ui8* t00 = &texture.rgba[(iy0 * texture.width + ix0) * 4];
+			const ui8* t10 = &texture.rgba[(iy0 * texture.width + ix1) * 4];
+			const ui8* t01 = &texture.rgba[(iy1 * texture.width + ix0) * 4];
+			const ui8* t11 = &texture.rgba[(iy1 * texture.width + ix1) * 4];
+
+			for (ui32 k = 0; k < 4; k++) {
+				const float top = t00[k] + (t10[k] - t00[k]) * wx;
+				const float bottom = t01[k] + (t11[k] - t01[k]) * wx;
+				out[k] = (top + (bottom - top) * wy) / 255.f;
+			}
+		}
+
+		static i32 Wrap(i32 i, i32 size, bool clamp) {
+			if (clamp) return i < 0 ? 0 : (i >= size ? size - 1 : i);
+			i %= size;
+			return i < 0 ? i + size : i;
+		}
+	};
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+in vec4 vColor;
+in vec2 vTexCord;
+flat in uint vSlot;
+
+out vec4 fColor;
+
+/*16 is the least GL_MAX_TEXTURE_IMAGE_UNITS a 3.3 context has, keep in sync with VoiOGLEngine::TEXTURE_SLOTS*/
+uniform sampler2D tex[16];
+
+/*3.30 only indexes sampler arrays with constant expressions, so the slot picks one of them through a switch*/
+#define SLOT(n) case n: return texture(tex[n], uv);
+
+vec4 slotTexture(uint slot, vec2 uv){
+	switch (int(slot)) {
+		SLOT(0) SLOT(1) SLOT(2) SLOT(3) SLOT(4) SLOT(5) SLOT(6) SLOT(7)
+		SLOT(8) SLOT(9) SLOT(10) SLOT(11) SLOT(12) SLOT(13) SLOT(14) SLOT(15)
+	}
+	return vec4(0.0);
+}
+
+void main(){
+	fColor = mix(slotTexture(vSlot, vTexCord), vec4(vColor.rgb,1.0), vColor.a);
+}
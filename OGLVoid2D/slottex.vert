@@ -0,0 +1,17 @@
+#version 330 core
+
+layout (location = 0) in vec3 iPos;
+layout (location = 1) in vec4 iColor;
+layout (location = 2) in vec2 iTexCord;
+layout (location = 3) in uint iSlot;
+
+out vec4 vColor;
+out vec2 vTexCord;
+flat out uint vSlot;
+
+void main(){
+	gl_Position = vec4(iPos, 1.0);
+	vColor = iColor;
+	vTexCord = iTexCord;
+	vSlot = iSlot;
+}
@@ -0,0 +1,20 @@
+#version 330 core
+
+layout (location = 0) in vec4 iRect;
+layout (location = 1) in float iZ;
+layout (location = 2) in vec4 iColor;
+layout (location = 3) in vec4 iTexRect;
+
+out vec4 vColor;
+out vec2 vTexCord;
+
+/*triangle strip over the corners of the rect, in the same winding FillRect/TextureRect use*/
+const vec2 corners[4] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0));
+
+void main(){
+	vec2 corner = corners[gl_VertexID];
+
+	gl_Position = vec4(iRect.xy + corner * iRect.zw, iZ, 1.0);
+	vColor = iColor;
+	vTexCord = mix(iTexRect.xy, iTexRect.zw, corner);
+}
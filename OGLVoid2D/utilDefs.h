@@ -15,3 +15,10 @@ typedef long long i64;
 
 typedef float f32;
 typedef double f64;
+
+/*"value" clamped to [0,1] as a normalized 16 bit integer, rounded to nearest, used for GL_UNSIGNED_SHORT normalized vertex attributes*/
+inline ui16 floatToUnorm16(f32 value) {
+	if (!(value > 0.f)) return 0;
+	if (value >= 1.f) return 0xffff;
+	return (ui16)(value * 65535.f + 0.5f);
+}